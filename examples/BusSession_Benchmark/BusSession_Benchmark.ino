@@ -0,0 +1,95 @@
+/**
+ * Created:   19.10.2026
+ *
+ *   Bus session benchmark
+ *
+ *   Times a mixed config-plus-output sequence with a transaction per frame
+ *   (default) and inside one DAC81416_BusSession, and prints the overhead
+ *   saved per frame.
+ *
+**/
+
+#include <Arduino.h>
+#include "dac81416.h"
+
+// Pin definitions
+#define DAC_CS 10
+#define DAC_RST 4
+#define DAC_LDAC 5
+
+// Sequence repeats per measurement
+#define RUNS 100
+
+// Frames in one sequence:
+// 4 ranges + 1 GENCONFIG + 16 outputs + 1 TRIGGER + 2 STATUS reads (2 frames each)
+#define SEQ_FRAMES (4 + 1 + 16 + 1 + 2*2)
+
+DAC81416 dac(DAC_CS, DAC_RST, DAC_LDAC, &SPI, 30000000);
+
+void sequence()
+{
+  dac.set_range(0, DAC81416::U_5);
+  dac.set_range(4, DAC81416::U_10);
+  dac.set_range(8, DAC81416::B_5);
+  dac.set_range(12, DAC81416::B_10);
+  dac.set_int_reference(true);
+
+  for(int i=0; i<=15; i++)
+  {
+    dac.set_out(i, i * 0x1000);
+  }
+
+  dac.trigger_ldac();
+  dac.get_status();
+  dac.get_status();
+}
+
+unsigned long time_sequence(bool session)
+{
+  unsigned long start = micros();
+
+  for(int r=0; r<RUNS; r++)
+  {
+    if(session)
+    {
+      DAC81416_BusSession bus(dac);
+      sequence();
+    }
+    else
+    {
+      sequence();
+    }
+  }
+
+  return micros() - start;
+}
+
+void setup() {
+
+  Serial.begin(115200);
+
+  dac.init(CRC_DISABLE, DAC81416::U_5);
+
+  unsigned long plain = time_sequence(false);
+  unsigned long held = time_sequence(true);
+
+  float frames = (float)RUNS * SEQ_FRAMES;
+
+  Serial.print("Transaction per frame: ");
+  Serial.print(plain / frames);
+  Serial.println(" us/frame");
+
+  Serial.print("Bus session:           ");
+  Serial.print(held / frames);
+  Serial.println(" us/frame");
+
+  Serial.print("Saved per frame:       ");
+  Serial.print(((long)plain - (long)held) / frames);
+  Serial.println(" us");
+
+} //SETUP
+
+//Not Used
+void loop()
+{
+}
@@ -28,9 +28,18 @@ void setup() {
 
   if (DEBUG_FLAG){Serial.begin(115200);}; 
 
+  // Verify config writes and resync automatically, 5ms budget per write
+  dac.set_robust(true, 5000);
+
   // Initialise DAC only Non-CRC mode supported
   uint16_t DAC_INIT = dac.init(0, DAC81416::U_5);
   Serial.println(dac.get_deviceid(),HEX);  
+
+  // Config writes that never verified, e.g. a bad SPI connection
+  if (dac.get_cfg_error_count()) {
+      Serial.print("DAC CONFIG FAILED, register 0x");
+      Serial.println(dac.get_last_cfg_error(),HEX);
+  }
     
   // 2.5V internal reference
   dac.set_int_reference(false);
@@ -153,6 +162,17 @@ void loop() {
         Serial.println("CRC ALARM");
     }
 
+    // Resync and restore the config if the DAC lost it
+    uint16_t recoveries = dac.get_recovery_count();
+    if (!dac.check()) {
+        Serial.println("DAC RESYNC FAILED");
+    }
+    else if (dac.get_recovery_count() != recoveries) {
+        Serial.print("DAC resynced in ");
+        Serial.print(dac.get_last_recovery_us());
+        Serial.println("us");
+    }
+
     // Use LDAC to Sync
     dac.sync();
 
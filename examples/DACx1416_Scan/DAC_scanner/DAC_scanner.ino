@@ -6,34 +6,23 @@
  *   Based on partial implementation for the TI80404 https://github.com/sphCow/DAC81404_lib
  *   
  *   Used to find multiple DAC ICs on SPI Bus by using CS pin
+ *   Only reads DEVICEID once per CS, the DACs are not reset or reconfigured
  *   
 **/
 
 #include <Arduino.h>
 #include "dac81416.h"
 
-// DAC Types
-#define DACID_81416 0x29C
-#define DACID_71416 0x28C
-#define DACID_61416 0x24C
+// DAC Types, DACID_xxxxx come from dac81416.h
 #define DACNAME_81416 "Texas Instruments 81416"
 #define DACNAME_71416 "Texas Instruments 71416"
 #define DACNAME_61416 "Texas Instruments 61416"
 
-// DAC scan results
-typedef struct {    
-    int CS;
-    bool ALIVE;
-    int DEVICEID;
-    int VERSIONID;
-  } DAC;
-
-// Pin definitions
-#define DAC_RST 4
-
 // Put CS PINs in here
 int DAC_CS_ARRAY[4] = {10, 4, 5, 6};
-DAC DAC_ARRAY[4];
+
+// DAC scan results
+DAC81416_Probe DAC_ARRAY[4];
 
 // Looks up the DAC
 String DACLookup(int deviceid)
@@ -57,49 +46,25 @@ void setup() {
 
   Serial.begin(115200);
 
-  // Loop over DAC_CS_ARRAY
-  // Initialise DAC
-  for(int i=0; i<sizeof(DAC_CS_ARRAY) / sizeof(DAC_CS_ARRAY[0]); i++)
-  {
-    // Setup the DAC on CS pin from array
-    DAC81416 dac(DAC_CS_ARRAY[i], DAC_RST, -1, &SPI, 30000000);
-
-    // Init the DAC
-    uint16_t DAC_INIT = dac.init(CRC_DISABLE, DAC81416::U_5);
-
-    // Start populating the result
-    DAC_ARRAY[i].CS = DAC_CS_ARRAY[i];
-
-    // Populate the alive status
-    DAC_ARRAY[i].ALIVE = dac.is_alive();
-
-    // Check the DAC is alive
-    if (DAC_ARRAY[i].ALIVE)
-    {
-      DAC_ARRAY[i].DEVICEID = dac.get_deviceid();
-      DAC_ARRAY[i].VERSIONID = dac.get_versionid();
-    }
-    else
-    {
-      DAC_ARRAY[i].DEVICEID = -1;
-      DAC_ARRAY[i].VERSIONID = -1;
-    }
-  } 
-
-  int found_count = 0;
+  // Probe every CS in DAC_CS_ARRAY
+  unsigned long start = micros();
+  int found_count = DAC81416::probe_bus(DAC_CS_ARRAY, sizeof(DAC_CS_ARRAY) / sizeof(DAC_CS_ARRAY[0]),
+                                        DAC_ARRAY, &SPI, 30000000);
+  unsigned long took = micros() - start;
 
   // Now acess the results
   for(int i=0; i<sizeof(DAC_ARRAY) / sizeof(DAC_ARRAY[0]); i++)
   {
-    if (DAC_ARRAY[i].ALIVE)
+    if (DAC_ARRAY[i].alive)
     {
-      found_count++;
       Serial.print("Found DAC on CS PIN: ");
-      Serial.print(DAC_ARRAY[i].CS);
+      Serial.print(DAC_ARRAY[i].cs);
       Serial.print(" with DEVICEID ");
-      Serial.print(DAC_ARRAY[i].DEVICEID,HEX);
+      Serial.print(DAC_ARRAY[i].deviceid,HEX);
+      Serial.print(" version ");
+      Serial.print(DAC_ARRAY[i].versionid);
       Serial.print(" (");
-      Serial.print(DACLookup(DAC_ARRAY[i].DEVICEID));
+      Serial.print(DACLookup(DAC_ARRAY[i].deviceid));
       Serial.println(")");
     }
   }
@@ -107,7 +72,9 @@ void setup() {
   // Show how many were counted
   Serial.print("Found ");
   Serial.print(found_count);
-  Serial.println(" DAC device(s)");
+  Serial.print(" DAC device(s) in ");
+  Serial.print(took);
+  Serial.println("us");
   
 } //SETUP
 
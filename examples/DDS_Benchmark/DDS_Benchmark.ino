@@ -0,0 +1,91 @@
+/**
+ * Created:   19.10.2026
+ *
+ *   DDS engine example and benchmark
+ *
+ *   Runs the DDS tick as fast as possible for 1 to 16 channels and prints the
+ *   maximum achievable tick rate for each channel count. Then leaves a
+ *   sine / triangle / quadrature sine running on channels 0-2.
+ *
+**/
+
+#include <Arduino.h>
+#include "dac81416.h"
+#include "dac81416_dds.h"
+
+// Pin definitions
+#define DAC_CS 10
+#define DAC_RST 4
+#define DAC_LDAC 5
+
+// Ticks timed per channel count
+#define BENCH_TICKS 1000
+
+// Tick rate used for the demo waveforms
+#define TICK_HZ 2000
+
+DAC81416 dac(DAC_CS, DAC_RST, DAC_LDAC, &SPI, 30000000);
+DAC81416_DDS dds(&dac, TICK_HZ);
+
+void setup() {
+
+  Serial.begin(115200);
+
+  dac.init(CRC_DISABLE, DAC81416::U_5);
+  dac.set_int_reference(true);
+
+  for(int i=0; i<=15; i++)
+  {
+      dac.set_ch_enabled(i, true);
+  }
+
+  Serial.println("channels  us/tick  max_tick_hz");
+
+  for(int n=1; n<=16; n++)
+  {
+    // Add one more channel each round
+    dds.start(n-1, DAC81416_DDS::SINE, 100, 32767, 0x8000);
+
+    unsigned long start = micros();
+    for(int t=0; t<BENCH_TICKS; t++)
+    {
+      dds.tick();
+    }
+    unsigned long took = micros() - start;
+
+    float us_per_tick = (float)took / BENCH_TICKS;
+
+    Serial.print(n);
+    Serial.print("         ");
+    Serial.print(us_per_tick);
+    Serial.print("    ");
+    Serial.println(1000000.0 / us_per_tick);
+  }
+
+  // Demo: 50Hz sine, triangle, and sine 90 degrees behind channel 0
+  for(int i=0; i<=15; i++)
+  {
+    dds.stop(i);
+  }
+
+  dds.start(0, DAC81416_DDS::SINE, 50, 30000, 0x8000);
+  dds.start(1, DAC81416_DDS::TRIANGLE, 50, 30000, 0x8000);
+  dds.start(2, DAC81416_DDS::SINE, 50, 30000, 0x8000);
+  dds.set_phase(2, 0xC000);
+  dds.reset_phase();
+
+} //SETUP
+
+unsigned long nextTick = 0;
+
+void loop() {
+
+  // Poll at TICK_HZ, a timer ISR calling dds.tick() works the same way
+  unsigned long now = micros();
+
+  if ((long)(now - nextTick) >= 0)
+  {
+    nextTick += 1000000UL / TICK_HZ;
+    dds.tick();
+  }
+}
@@ -0,0 +1,21 @@
+#ifndef DAC81416_TEST_COMMON_H
+#define DAC81416_TEST_COMMON_H
+
+// Minimal host test helpers, each test is a standalone program returning non-zero on failure
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do { \
+        if(!(cond)) { \
+            test_failures++; \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while(0)
+
+#define TEST_DONE() ( \
+        printf("%s: %s\n", __FILE__, test_failures ? "FAILED" : "ok"), \
+        test_failures ? 1 : 0)
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * DAC81416_UpdateQueue host stress test
+ *
+ *   Several std::thread producers push into the queue while one consumer
+ *   drains it into a simulated DAC. Checks that every channel ends on the
+ *   last value pushed, that no channel ever goes back to an older value
+ *   (nothing stale overwrites a newer update), and that bursts coalesce.
+ *
+ *   Build (host), from this directory:
+ *     g++ -O2 -pthread -I../../src -I../trace_tools test_queue.cpp
+ *         ../../src/dac81416.cpp ../../src/dac81416_transport.cpp
+ *         ../../src/dac81416_queue.cpp -o test_queue
+ *
+**/
+
+#include <atomic>
+#include <thread>
+#include "dac81416_queue.h"
+#include "dac81416_sim.h"
+#include "test_common.h"
+
+#define PRODUCERS 4
+#define PUSHES    50000
+
+// Simulated DAC that also checks DAC writes only ever move forward per channel
+class CheckingSim : public DAC81416_Sim {
+    public:
+        uint16_t last[16];
+        uint32_t writes;
+        uint32_t went_back;
+
+        CheckingSim() {
+            for(int ch=0; ch<=15; ch++) last[ch] = 0;
+            writes = 0;
+            went_back = 0;
+        }
+
+        void transfer(const uint8_t *tx, uint8_t *rx, uint8_t len, uint16_t count) {
+            for(uint16_t f=0; f<count; f++) {
+                const uint8_t *frame = tx + f*len;
+                uint8_t reg = frame[0] & 0x3F;
+
+                if(!(frame[0] & 0x80) && reg >= R_DAC0 && reg <= R_DAC15) {
+                    uint16_t val = (frame[1] << 8) | frame[2];
+                    if(val < last[reg - R_DAC0]) went_back++;
+                    last[reg - R_DAC0] = val;
+                    writes++;
+                }
+            }
+
+            DAC81416_Sim::transfer(tx, rx, len, count);
+        }
+};
+
+static void test_coalescing() {
+    CheckingSim sim;
+    DAC81416 dac(&sim);
+    DAC81416_UpdateQueue queue;
+
+    CHECK(queue.attach(&dac) == 0);
+    CHECK(!queue.pending());
+
+    queue.push(0, 3, 100);
+    queue.push(0, 3, 200);
+    queue.push(0, 3, 300);
+    queue.push(0, 7, 1);
+
+    CHECK(queue.pending());
+    CHECK(queue.drain() == 2);
+    CHECK(sim.writes == 2);
+    CHECK(sim.output[3] == 300);
+    CHECK(sim.output[7] == 1);
+    CHECK(!queue.pending());
+    CHECK(queue.drain() == 0);
+
+    // Out of range requests are refused
+    CHECK(!queue.push(1, 0, 0));
+    CHECK(!queue.push(0, 16, 0));
+}
+
+static void test_stress() {
+    CheckingSim sim;
+    DAC81416 dac(&sim);
+    DAC81416_UpdateQueue queue;
+
+    queue.attach(&dac);
+
+    std::atomic<bool> done(false);
+    uint32_t drained = 0;
+
+    // Single bus owner
+    std::thread consumer([&] {
+        while(!done.load()) drained += queue.drain();
+        drained += queue.drain();
+    });
+
+    // Each producer owns 4 channels and pushes 1..PUSHES to each in turn
+    std::thread producers[PRODUCERS];
+
+    for(int p=0; p<PRODUCERS; p++) {
+        producers[p] = std::thread([&queue, p] {
+            for(uint16_t i=1; i<=PUSHES; i++) {
+                for(int c=0; c<4; c++) queue.push(0, p*4 + c, i);
+
+                // Let the consumer interleave with the producers
+                if(!(i & 63)) std::this_thread::yield();
+            }
+        });
+    }
+
+    for(int p=0; p<PRODUCERS; p++) producers[p].join();
+    done.store(true);
+    consumer.join();
+
+    for(int ch=0; ch<=15; ch++) CHECK(sim.output[ch] == PUSHES);
+
+    CHECK(sim.went_back == 0);
+    CHECK(!queue.pending());
+    CHECK(drained == sim.writes);
+    CHECK(sim.writes <= (uint32_t)PRODUCERS * 4 * PUSHES);
+
+    printf("%lu pushes, %lu writes after coalescing\n",
+           (unsigned long)PRODUCERS * 4 * PUSHES, (unsigned long)sim.writes);
+}
+
+int main() {
+    test_coalescing();
+    test_stress();
+
+    return TEST_DONE();
+}
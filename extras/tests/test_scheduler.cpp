@@ -0,0 +1,279 @@
+/**
+ * DAC81416_Scheduler host test
+ *
+ *   Drives the scheduler against DAC81416_Sim with a simulated clock, through
+ *   poll(now_us) and DAC81416_Sim::advance_us(). Covers same tick grouping
+ *   (one batch and one LDAC per tick), ties between events with the same time,
+ *   wrap-around of the microsecond clock, the lateness statistics and the
+ *   software LDAC fallback.
+ *
+ *   Build (host), from this directory:
+ *     g++ -O2 -I../../src -I../trace_tools test_scheduler.cpp ../../src/dac81416.cpp
+ *         ../../src/dac81416_transport.cpp ../../src/dac81416_scheduler.cpp -o test_scheduler
+ *
+**/
+
+#include "dac81416_scheduler.h"
+#include "dac81416_sim.h"
+#include "test_common.h"
+
+#define CAPACITY 32
+
+// Simulated DAC that counts bus calls, and can pretend LDAC is not wired
+class CountingSim : public DAC81416_Sim {
+    public:
+        bool ldac_wired;
+        uint32_t batches;
+        uint32_t batch_frames;
+        uint32_t pulses;
+
+        // Bus calls seen when the last LDAC pulse came
+        uint32_t batches_at_pulse;
+
+        CountingSim(bool ldac = true) {
+            ldac_wired = ldac;
+            reset_counts();
+        }
+
+        void reset_counts() {
+            batches = 0;
+            batch_frames = 0;
+            pulses = 0;
+            batches_at_pulse = 0;
+        }
+
+        void transfer(const uint8_t *tx, uint8_t *rx, uint8_t len, uint16_t count) {
+            batches++;
+            batch_frames += count;
+            DAC81416_Sim::transfer(tx, rx, len, count);
+        }
+
+        void pulse_ldac() {
+            pulses++;
+            batches_at_pulse = batches;
+            DAC81416_Sim::pulse_ldac();
+        }
+
+        bool has_ldac() {
+            return ldac_wired;
+        }
+};
+
+// Every channel in SYNC mode, so outputs only move on LDAC
+static void setup(CountingSim &sim, DAC81416 &dac, DAC81416_Scheduler &sched) {
+    for(int ch=0; ch<=15; ch++) dac.set_sync(ch, DAC81416::SYNC);
+
+    CHECK(sched.attach(&dac) == 0);
+    sim.reset_counts();
+}
+
+static void test_same_tick_grouping() {
+    CountingSim sim;
+    DAC81416 dac(&sim);
+    DAC81416_Event storage[CAPACITY];
+    DAC81416_Scheduler sched(storage, CAPACITY);
+
+    setup(sim, dac, sched);
+
+    CHECK(sched.schedule(100, 0, 1, 0x1111));
+    CHECK(sched.schedule(200, 0, 4, 0x4444));
+    CHECK(sched.schedule(100, 0, 2, 0x2222));
+    CHECK(sched.schedule(100, 0, 3, 0x3333));
+
+    CHECK(sched.size() == 4);
+    CHECK(sched.next_due() == 100);
+
+    // Nothing due yet
+    CHECK(sched.poll(99) == 0);
+    CHECK(sim.batches == 0);
+    CHECK(sim.pulses == 0);
+
+    // The three t=100 events go out in one batch, then one LDAC
+    CHECK(sched.poll(100) == 3);
+    CHECK(sim.batches == 1);
+    CHECK(sim.batch_frames == 3);
+    CHECK(sim.pulses == 1);
+    CHECK(sim.batches_at_pulse == 1);
+
+    CHECK(sim.output[1] == 0x1111);
+    CHECK(sim.output[2] == 0x2222);
+    CHECK(sim.output[3] == 0x3333);
+    CHECK(sim.output[4] == 0);
+
+    CHECK(sched.size() == 1);
+    CHECK(sched.next_due() == 200);
+
+    CHECK(sched.poll(200) == 1);
+    CHECK(sim.output[4] == 0x4444);
+    CHECK(sim.pulses == 2);
+    CHECK(sched.empty());
+
+    // Nothing left, nothing written
+    CHECK(sched.poll(1000) == 0);
+    CHECK(sim.batches == 2);
+}
+
+static void test_same_time_same_channel() {
+    CountingSim sim;
+    DAC81416 dac(&sim);
+    DAC81416_Event storage[CAPACITY];
+    DAC81416_Scheduler sched(storage, CAPACITY);
+
+    setup(sim, dac, sched);
+
+    // Unrelated events first so the heap is not trivially ordered
+    for(int i=0; i<6; i++) sched.schedule(5 + i, 0, 8 + i, i);
+
+    sched.schedule(10, 0, 0, 0x0100);
+    sched.schedule(10, 0, 0, 0x0200);
+    sched.schedule(10, 0, 0, 0x0300);
+    sched.schedule(10, 0, 0, 0x0400);
+
+    // Several due events on one channel are still a single write, the last scheduled wins
+    CHECK(sched.poll(10) == 7);
+    CHECK(sim.batch_frames == 7);
+    CHECK(sim.output[0] == 0x0400);
+
+    // Earlier time beats insertion order
+    sched.schedule(30, 0, 0, 0x3000);
+    sched.schedule(20, 0, 0, 0x2000);
+
+    CHECK(sched.poll(30) == 1);
+    CHECK(sim.output[0] == 0x3000);
+}
+
+static void test_wraparound() {
+    CountingSim sim;
+    DAC81416 dac(&sim);
+    DAC81416_Event storage[CAPACITY];
+    DAC81416_Scheduler sched(storage, CAPACITY);
+
+    setup(sim, dac, sched);
+
+    // 256us before the clock wraps
+    sim.advance_us(0xFFFFFF00UL - sim.now_us());
+    uint32_t now = sim.now_us();
+
+    // After the wrap, before the wrap
+    CHECK(sched.schedule(now + 0x200, 0, 1, 0xBBBB));
+    CHECK(sched.schedule(now + 0x80, 0, 0, 0xAAAA));
+
+    CHECK(sched.next_due() == now + 0x80);
+
+    CHECK(sched.poll() == 0);
+
+    sim.advance_us(0x100);
+    CHECK(sim.now_us() == 0);
+
+    // Only the pre-wrap event is due, 0 is after 0xFFFFFF80
+    CHECK(sched.poll() == 1);
+    CHECK(sim.output[0] == 0xAAAA);
+    CHECK(sim.output[1] == 0);
+    CHECK(sched.next_due() == 0x100);
+
+    sim.advance_us(0xFF);
+    CHECK(sched.poll() == 0);
+
+    sim.advance_us(1);
+    CHECK(sched.poll() == 1);
+    CHECK(sim.output[1] == 0xBBBB);
+    CHECK(sched.empty());
+}
+
+static void test_lateness() {
+    CountingSim sim;
+    DAC81416 dac(&sim);
+    DAC81416_Event storage[CAPACITY];
+    DAC81416_Scheduler sched(storage, CAPACITY);
+
+    setup(sim, dac, sched);
+
+    sched.schedule(1000, 0, 0, 1);
+    sched.schedule(2000, 0, 1, 2);
+    sched.schedule(2000, 0, 2, 3);
+
+    sched.poll(1010);
+    sched.poll(2050);
+
+    CHECK(sched.get_fired() == 3);
+    CHECK(sched.get_ticks() == 2);
+    CHECK(sched.get_late_max_us() == 50);
+    CHECK(sched.get_late_mean_us() == (10 + 50 + 50) / 3);
+
+    // An empty poll is not a tick
+    sched.poll(3000);
+    CHECK(sched.get_ticks() == 2);
+
+    sched.reset_stats();
+
+    CHECK(sched.get_fired() == 0);
+    CHECK(sched.get_ticks() == 0);
+    CHECK(sched.get_late_max_us() == 0);
+    CHECK(sched.get_late_mean_us() == 0);
+
+    // Total lateness past 2^32 us still gives the right mean
+    const uint32_t late = 0x7FFF0000UL;
+    uint32_t t = 0;
+
+    for(int i=0; i<4; i++) {
+        sched.schedule(t, 0, i, i);
+        t += late;
+        sched.poll(t);
+    }
+
+    CHECK(sched.get_fired() == 4);
+    CHECK(sched.get_late_max_us() == late);
+    CHECK(sched.get_late_mean_us() == late);
+}
+
+static void test_limits() {
+    CountingSim sim;
+    DAC81416 dac(&sim);
+    DAC81416_Event storage[4];
+    DAC81416_Scheduler sched(storage, 4);
+
+    // No DAC attached yet
+    CHECK(!sched.schedule(0, 0, 0, 0));
+
+    setup(sim, dac, sched);
+
+    CHECK(!sched.schedule(0, 1, 0, 0));
+    CHECK(!sched.schedule(0, 0, 16, 0));
+
+    for(int i=0; i<4; i++) CHECK(sched.schedule(i, 0, i, i));
+    CHECK(!sched.schedule(4, 0, 4, 4));
+
+    sched.clear();
+    CHECK(sched.empty());
+    CHECK(sched.poll(100) == 0);
+}
+
+static void test_software_ldac() {
+    CountingSim sim(false);
+    DAC81416 dac(&sim);
+    DAC81416_Event storage[CAPACITY];
+    DAC81416_Scheduler sched(storage, CAPACITY);
+
+    setup(sim, dac, sched);
+
+    sched.schedule(10, 0, 5, 0x5555);
+    sched.schedule(10, 0, 6, 0x6666);
+
+    // No LDAC line, the load goes through TRIGGER as a second bus call
+    CHECK(sched.poll(10) == 2);
+    CHECK(sim.pulses == 0);
+    CHECK(sim.batches == 2);
+    CHECK(sim.output[5] == 0x5555);
+    CHECK(sim.output[6] == 0x6666);
+}
+
+int main() {
+    test_same_tick_grouping();
+    test_same_time_same_channel();
+    test_wraparound();
+    test_lateness();
+    test_limits();
+    test_software_ldac();
+
+    return TEST_DONE();
+}
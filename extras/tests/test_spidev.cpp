@@ -0,0 +1,302 @@
+/**
+ * DAC81416_Spidev host test
+ *
+ *   Runs the spidev transport against a recording DAC81416_SpidevOps table
+ *   instead of /dev/spidevX.Y and checks what it submits: one SPI_IOC_MESSAGE
+ *   per batch, cs_change between frames, batches over the limit split across
+ *   ioctls, the GPIO line requests, and that a dead bus reads as zeros.
+ *
+ *   Build (host), from this directory:
+ *     g++ -O2 -I../../src test_spidev.cpp ../../src/dac81416.cpp
+ *         ../../src/dac81416_transport.cpp ../../src/dac81416_spidev.cpp -o test_spidev
+ *
+**/
+
+#include <string.h>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include "dac81416.h"
+#include "dac81416_spidev.h"
+#include "test_common.h"
+
+#define SPI_FD  10
+#define CHIP_FD 11
+#define LINE_FD 20  // first line handle, the next one gets LINE_FD + 1
+
+#define MAX_CALLS 64
+
+// What the fake saw
+struct Message {
+    int fd;
+    uint16_t n;
+    uint32_t len[DAC81416_SPIDEV_MAX_XFERS];
+    bool cs_change[DAC81416_SPIDEV_MAX_XFERS];
+    uint8_t first_byte[DAC81416_SPIDEV_MAX_XFERS];
+};
+
+struct LineRequest {
+    uint32_t offset;
+    uint32_t flags;
+    uint8_t default_value;
+};
+
+struct LineSet {
+    int fd;
+    uint8_t value;
+};
+
+static struct {
+    bool open_fails;
+    bool message_fails;
+
+    int opened;
+    int closed;
+
+    Message msg[MAX_CALLS];
+    int msgs;
+
+    LineRequest req[MAX_CALLS];
+    int reqs;
+
+    LineSet set[MAX_CALLS];
+    int sets;
+} fake;
+
+static void fake_reset() {
+    memset(&fake, 0, sizeof(fake));
+}
+
+static int fake_open(const char *path, int) {
+    if(fake.open_fails) return -1;
+
+    fake.opened++;
+    return strstr(path, "gpiochip") ? CHIP_FD : SPI_FD;
+}
+
+static int fake_close(int) {
+    fake.closed++;
+    return 0;
+}
+
+static int fake_ioctl(int fd, unsigned long request, void *arg) {
+
+    if(_IOC_TYPE(request) == SPI_IOC_MAGIC && _IOC_NR(request) == 0) {
+        // SPI_IOC_MESSAGE(n), n is encoded in the size field
+        uint16_t n = _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer);
+        const struct spi_ioc_transfer *xfer = (const struct spi_ioc_transfer *)arg;
+
+        if(fake.msgs < MAX_CALLS) {
+            Message &m = fake.msg[fake.msgs++];
+            m.fd = fd;
+            m.n = n;
+
+            for(uint16_t f=0; f<n && f<DAC81416_SPIDEV_MAX_XFERS; f++) {
+                m.len[f] = xfer[f].len;
+                m.cs_change[f] = xfer[f].cs_change;
+                m.first_byte[f] = *(const uint8_t *)(uintptr_t)xfer[f].tx_buf;
+            }
+        }
+
+        if(fake.message_fails) return -1;
+
+        // Pretend a device answers every byte with 0xA5
+        for(uint16_t f=0; f<n; f++) {
+            if(xfer[f].rx_buf) memset((void *)(uintptr_t)xfer[f].rx_buf, 0xA5, xfer[f].len);
+        }
+        return n;
+    }
+
+    if(request == GPIO_GET_LINEHANDLE_IOCTL) {
+        struct gpiohandle_request *req = (struct gpiohandle_request *)arg;
+
+        LineRequest &r = fake.req[fake.reqs];
+        r.offset = req->lineoffsets[0];
+        r.flags = req->flags;
+        r.default_value = req->default_values[0];
+
+        req->fd = LINE_FD + fake.reqs++;
+        return 0;
+    }
+
+    if(request == GPIOHANDLE_SET_LINE_VALUES_IOCTL) {
+        struct gpiohandle_data *data = (struct gpiohandle_data *)arg;
+
+        LineSet &s = fake.set[fake.sets++];
+        s.fd = fd;
+        s.value = data->values[0];
+        return 0;
+    }
+
+    // Mode, bits per word, speed
+    return 0;
+}
+
+static const DAC81416_SpidevOps FAKE_OPS = { fake_open, fake_close, fake_ioctl };
+
+static void check_cs_change(const Message &m) {
+    for(uint16_t f=0; f<m.n; f++) {
+        CHECK(m.len[f] == DAC81416_FRAME_LEN);
+        CHECK(m.cs_change[f] == (f != m.n - 1));
+    }
+}
+
+static void test_batch_is_one_message() {
+    fake_reset();
+
+    DAC81416_Spidev bus("/dev/spidev0.0", 8000000, 0, -1, -1, &FAKE_OPS);
+    bus.begin();
+    CHECK(bus.ok());
+
+    DAC81416 dac(&bus);
+
+    uint8_t channels[16];
+    uint16_t values[16];
+
+    for(int i=0; i<16; i++) {
+        channels[i] = i;
+        values[i] = 0x1000 * i;
+    }
+
+    dac.set_out_batch(channels, values, 16);
+
+    CHECK(fake.msgs == 1);
+    CHECK(fake.msg[0].fd == SPI_FD);
+    CHECK(fake.msg[0].n == 16);
+    CHECK(fake.msg[0].first_byte[0] == R_DAC0);
+    CHECK(fake.msg[0].first_byte[15] == R_DAC15);
+    check_cs_change(fake.msg[0]);
+
+    // A single frame is a message of one, CS released at its end
+    fake.msgs = 0;
+    dac.set_out(5, 0x1234);
+
+    CHECK(fake.msgs == 1);
+    CHECK(fake.msg[0].n == 1);
+    CHECK(!fake.msg[0].cs_change[0]);
+}
+
+static void test_large_batch_is_split() {
+    fake_reset();
+
+    DAC81416_Spidev bus("/dev/spidev0.0", 8000000, 0, -1, -1, &FAKE_OPS);
+    bus.begin();
+
+    const uint16_t count = 2 * DAC81416_SPIDEV_MAX_XFERS + 5;
+    static uint8_t tx[count * DAC81416_FRAME_LEN];
+
+    for(uint16_t f=0; f<count; f++) tx[f * DAC81416_FRAME_LEN] = f & 0xFF;
+
+    bus.transfer(tx, 0, DAC81416_FRAME_LEN, count);
+
+    CHECK(fake.msgs == 3);
+    CHECK(fake.msg[0].n == DAC81416_SPIDEV_MAX_XFERS);
+    CHECK(fake.msg[1].n == DAC81416_SPIDEV_MAX_XFERS);
+    CHECK(fake.msg[2].n == 5);
+
+    // Each chunk picks up where the last one stopped
+    CHECK(fake.msg[1].first_byte[0] == DAC81416_SPIDEV_MAX_XFERS);
+    CHECK(fake.msg[2].first_byte[0] == 2 * DAC81416_SPIDEV_MAX_XFERS);
+
+    for(int i=0; i<fake.msgs; i++) check_cs_change(fake.msg[i]);
+}
+
+static void test_gpio_lines() {
+    fake_reset();
+
+    {
+        DAC81416_Spidev bus("/dev/spidev0.0", 8000000, "/dev/gpiochip0", 17, 27, &FAKE_OPS);
+        bus.begin();
+
+        // RESET first, then LDAC, both outputs idling HIGH
+        CHECK(fake.reqs == 2);
+        CHECK(fake.req[0].offset == 17);
+        CHECK(fake.req[1].offset == 27);
+
+        for(int i=0; i<fake.reqs; i++) {
+            CHECK(fake.req[i].flags == GPIOHANDLE_REQUEST_OUTPUT);
+            CHECK(fake.req[i].default_value == 1);
+        }
+
+        CHECK(bus.has_reset());
+        CHECK(bus.has_ldac());
+
+        // LDAC pulse is low then high on the LDAC handle
+        bus.pulse_ldac();
+
+        CHECK(fake.sets == 2);
+        CHECK(fake.set[0].fd == LINE_FD + 1 && fake.set[0].value == 0);
+        CHECK(fake.set[1].fd == LINE_FD + 1 && fake.set[1].value == 1);
+
+        bus.set_reset(false);
+        CHECK(fake.sets == 3);
+        CHECK(fake.set[2].fd == LINE_FD && fake.set[2].value == 0);
+    }
+
+    // spidev, gpiochip, two line handles, all closed again
+    CHECK(fake.opened == 2);
+    CHECK(fake.closed == 4);
+
+    // No lines asked for, none requested
+    fake_reset();
+
+    DAC81416_Spidev bus("/dev/spidev0.0", 8000000, "/dev/gpiochip0", -1, -1, &FAKE_OPS);
+    bus.begin();
+
+    CHECK(fake.reqs == 0);
+    CHECK(!bus.has_reset());
+    CHECK(!bus.has_ldac());
+
+    bus.pulse_ldac();
+    CHECK(fake.sets == 0);
+
+    // So sync() loads the SYNC channels through TRIGGER instead
+    DAC81416 dac(&bus);
+    dac.sync();
+
+    CHECK(fake.msgs == 1);
+    CHECK(fake.msg[0].n == 1);
+    CHECK(fake.msg[0].first_byte[0] == R_TRIGGER);
+}
+
+static void test_dead_bus_reads_zero() {
+    fake_reset();
+    fake.open_fails = true;
+
+    DAC81416_Spidev dead("/dev/spidev0.0", 8000000, 0, -1, -1, &FAKE_OPS);
+    dead.begin();
+    CHECK(!dead.ok());
+
+    DAC81416 dac(&dead);
+    CHECK(!dac.is_alive());
+
+    DAC81416_Probe result;
+    CHECK(!DAC81416::probe(&dead, &result));
+
+    // Opened, but every message fails
+    fake_reset();
+    fake.message_fails = true;
+
+    DAC81416_Spidev failing("/dev/spidev0.0", 8000000, 0, -1, -1, &FAKE_OPS);
+    failing.begin();
+    CHECK(failing.ok());
+
+    uint8_t tx[2 * DAC81416_FRAME_LEN] = {0};
+    uint8_t rx[2 * DAC81416_FRAME_LEN];
+    memset(rx, 0xEE, sizeof(rx));
+
+    failing.transfer(tx, rx, DAC81416_FRAME_LEN, 2);
+
+    for(unsigned i=0; i<sizeof(rx); i++) CHECK(rx[i] == 0);
+
+    DAC81416 dac2(&failing);
+    CHECK(!dac2.is_alive());
+}
+
+int main() {
+    test_batch_is_one_message();
+    test_large_batch_is_split();
+    test_gpio_lines();
+    test_dead_bus_reads_zero();
+
+    return TEST_DONE();
+}
@@ -0,0 +1,85 @@
+/**
+ * DAC81416_TraceTransport host test
+ *
+ *   Traces DAC81416_Sim through a RAM ring and checks that LDAC records are
+ *   only logged when the wrapped transport has an LDAC line, so a replay only
+ *   loads SYNC channels where the real device did.
+ *
+ *   Build (host), from this directory:
+ *     g++ -O2 -I../../src -I../trace_tools test_trace.cpp ../../src/dac81416.cpp
+ *         ../../src/dac81416_transport.cpp ../../src/dac81416_trace.cpp -o test_trace
+ *
+**/
+
+#include "dac81416_trace.h"
+#include "dac81416_sim.h"
+#include "test_common.h"
+
+#define RECORDS 64
+
+// Simulated DAC with LDAC wired or not
+class LdacSim : public DAC81416_Sim {
+    public:
+        bool ldac_wired;
+
+        LdacSim(bool ldac) { ldac_wired = ldac; }
+
+        void pulse_ldac() {
+            if(ldac_wired) DAC81416_Sim::pulse_ldac();
+        }
+
+        bool has_ldac() {
+            return ldac_wired;
+        }
+};
+
+static uint32_t count_kind(DAC81416_TraceLog &log, uint8_t kind) {
+    uint32_t n = 0;
+
+    for(uint32_t i=0; i<log.size(); i++) {
+        if(TRACE_KIND(log.at(i).flags) == kind) n++;
+    }
+
+    return n;
+}
+
+static void test_ldac_logged(bool wired) {
+    DAC81416_TraceRecord records[RECORDS];
+    DAC81416_TraceRing ring(records, RECORDS);
+
+    LdacSim sim(wired);
+    DAC81416_TraceTransport trace(&sim, &ring);
+    DAC81416 dac(&trace);
+
+    dac.set_sync(0, DAC81416::SYNC);
+    dac.set_out(0, 0x1234);
+    ring.clear();
+
+    dac.sync();
+
+    CHECK(sim.output[0] == 0x1234);
+
+    if(wired) {
+        // One LDAC edge, no bus traffic
+        CHECK(count_kind(ring, TRACE_LDAC) == 1);
+        CHECK(count_kind(ring, TRACE_FRAME) == 0);
+    }
+    else {
+        // The TRIGGER LDAC write is the only record
+        CHECK(count_kind(ring, TRACE_LDAC) == 0);
+        CHECK(count_kind(ring, TRACE_FRAME) == 1);
+        CHECK(ring.size() == 1 && (ring.at(0).tx[0] & 0x3F) == R_TRIGGER);
+    }
+
+    // A direct pulse is only logged if it reaches a real LDAC line
+    ring.clear();
+    trace.pulse_ldac();
+    CHECK(count_kind(ring, TRACE_LDAC) == (wired ? 1 : 0));
+}
+
+int main() {
+    test_ldac_logged(true);
+    test_ldac_logged(false);
+
+    return TEST_DONE();
+}
@@ -0,0 +1,168 @@
+/**
+ * DAC81416_WavePlayer host test
+ *
+ *   Writes small waveform files, plays them into DAC81416_Sim and checks the
+ *   per-channel ranges from the header end up in all four DACRANGE registers,
+ *   and that headers with reserved range codes or bad channels are refused.
+ *
+ *   Build (host), from this directory:
+ *     g++ -O2 -I../../src -I../trace_tools test_wavefile.cpp ../../src/dac81416.cpp
+ *         ../../src/dac81416_transport.cpp ../../src/dac81416_wavefile.cpp -o test_wavefile
+ *
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "dac81416_wavefile.h"
+#include "dac81416_sim.h"
+#include "test_common.h"
+
+static char path[] = "/tmp/dac81416_testXXXXXX";
+
+static bool write_file(uint8_t channels, const uint8_t *map, const DAC81416::ChannelRange *ranges,
+                       const uint16_t *frames, uint32_t count) {
+
+    DAC81416_WaveWriter writer;
+    if(!writer.open(path, 1000, channels, map, ranges)) return false;
+
+    for(uint32_t n=0; n<count; n++) {
+        if(!writer.write_frame(frames + n*channels)) return false;
+    }
+
+    return writer.close();
+}
+
+static void test_ranges_all_registers() {
+    DAC81416_Sim sim;
+    DAC81416 dac(&sim);
+
+    uint8_t map[16];
+    DAC81416::ChannelRange ranges[16];
+    uint16_t frame[16];
+
+    for(int i=0; i<16; i++) {
+        map[i] = i;
+        ranges[i] = DAC81416::B_10;
+        frame[i] = 0x1000 * i;
+    }
+
+    CHECK(write_file(16, map, ranges, frame, 1));
+
+    DAC81416_WavePlayer player(&dac);
+    CHECK(player.open(path));
+
+    player.apply_ranges();
+
+    // DACRANGE3 holds channels 0-3, DACRANGE0 channels 12-15
+    CHECK(sim.regs[R_DACRANGE0] == 0xAAAA);
+    CHECK(sim.regs[R_DACRANGE1] == 0xAAAA);
+    CHECK(sim.regs[R_DACRANGE2] == 0xAAAA);
+    CHECK(sim.regs[R_DACRANGE3] == 0xAAAA);
+
+    for(int ch=0; ch<=15; ch++) CHECK(dac.get_range(ch) == DAC81416::B_10);
+
+    CHECK(player.play(false) == 1);
+    for(int ch=0; ch<=15; ch++) CHECK(sim.output[ch] == 0x1000 * ch);
+}
+
+static void test_range_nibbles() {
+    DAC81416_Sim sim;
+    DAC81416 dac(&sim);
+
+    // A different range in each nibble of each register
+    const DAC81416::ChannelRange pick[4] = {DAC81416::U_10, DAC81416::B_5,
+                                            DAC81416::B_20, DAC81416::B_2V5};
+
+    for(int ch=0; ch<=15; ch++) dac.set_range(ch, pick[(ch + ch/4) % 4]);
+
+    for(int reg=0; reg<4; reg++) {
+        uint16_t expect = 0;
+
+        for(int n=0; n<4; n++) {
+            int ch = reg*4 + n;
+            expect |= pick[(ch + ch/4) % 4] << 4*n;
+        }
+
+        CHECK(sim.regs[R_DACRANGE3 - reg] == expect);
+    }
+
+    for(int ch=0; ch<=15; ch++) CHECK(dac.get_range(ch) == pick[(ch + ch/4) % 4]);
+
+    // Changing one channel leaves its neighbours alone
+    dac.set_range(13, DAC81416::U_5);
+    CHECK(dac.get_range(13) == DAC81416::U_5);
+    CHECK(dac.get_range(12) == pick[(12 + 3) % 4]);
+    CHECK(dac.get_range(14) == pick[(14 + 3) % 4]);
+
+    // A word that does not hold the requested range is counted and not sent
+    uint16_t before = sim.regs[R_DACRANGE3];
+    CHECK(dac.get_cfg_error_count() == 0);
+
+    dac.set_range(2, (DAC81416::ChannelRange)0x1F);
+
+    CHECK(dac.get_cfg_error_count() == 1);
+    CHECK(dac.get_last_cfg_error() == R_DACRANGE3);
+    CHECK(sim.regs[R_DACRANGE3] == before);
+
+    // Robust init on a healthy bus, every range write verifies
+    DAC81416_Sim sim2;
+    DAC81416 dac2(&sim2);
+
+    dac2.set_robust(true, 1000);
+    dac2.init(0, DAC81416::B_5);
+
+    CHECK(dac2.get_cfg_error_count() == 0);
+    for(int reg=R_DACRANGE0; reg<=R_DACRANGE3; reg++) CHECK(sim2.regs[reg] == 0x9999);
+}
+
+// Overwrite one header byte of the file at path
+static void patch_header(size_t offset, uint8_t value) {
+    FILE *f = fopen(path, "r+b");
+    if(!f) return;
+
+    fseek(f, offset, SEEK_SET);
+    fputc(value, f);
+    fclose(f);
+}
+
+static void test_bad_header_refused() {
+    DAC81416_Sim sim;
+    DAC81416 dac(&sim);
+    DAC81416_WavePlayer player(&dac);
+
+    uint8_t map[2] = {0, 1};
+    DAC81416::ChannelRange ranges[2] = {DAC81416::U_5, DAC81416::B_10};
+    uint16_t frame[2] = {0, 0};
+
+    CHECK(write_file(2, map, ranges, frame, 1));
+    CHECK(player.open(path));
+
+    // Reserved range code on a used channel
+    patch_header(offsetof(DAC81416_WaveHeader, range) + 1, 0x0F);
+    CHECK(!player.open(path));
+    CHECK(!player.header());
+
+    // Past the used channels the range bytes are not looked at
+    CHECK(write_file(2, map, ranges, frame, 1));
+    patch_header(offsetof(DAC81416_WaveHeader, range) + 2, 0x0F);
+    CHECK(player.open(path));
+
+    CHECK(write_file(2, map, ranges, frame, 1));
+    patch_header(offsetof(DAC81416_WaveHeader, channel_map) + 1, 16);
+    CHECK(!player.open(path));
+}
+
+int main() {
+    int fd = mkstemp(path);
+    if(fd < 0) return 1;
+    close(fd);
+
+    test_ranges_all_registers();
+    test_range_nibbles();
+    test_bad_header_refused();
+
+    unlink(path);
+
+    return TEST_DONE();
+}
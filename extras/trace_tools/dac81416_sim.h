@@ -0,0 +1,160 @@
+#ifndef DAC81416_SIM_H
+#define DAC81416_SIM_H
+
+// Includes
+
+#include <stdint.h>
+#include <string.h>
+#include "dac81416_transport.h"
+#include "dac81416.h"
+
+/*
+
+Simulated DAC81416
+
+A transport with a register model behind it instead of a bus, enough to run
+the library or replay a trace on the host:
+
+- Read command (bit 7 of the first byte) returns the register on the next
+  frame as {command, MSB, LSB}, only while SDO_EN is set in SPICONFIG
+- DACn writes go straight to the output, or wait for LDAC / TRIGGER LDAC if
+  the channel is set in SYNCCONFIG
+- BRDCAST updates every channel set in BRDCONFIG
+- TRIGGER soft reset code and the RESET line restore the power-on values
+
+Time only moves when delay_ms() or advance_us() is called.
+
+*/
+
+class DAC81416_Sim : public DAC81416_Transport {
+
+    private:
+        uint8_t _pending_cmd;
+        bool _pending_read;
+        bool _reset_level;
+        uint32_t _now_us;
+
+        void power_on() {
+            memset(regs, 0, sizeof(regs));
+            memset(buffer, 0, sizeof(buffer));
+            memset(output, 0, sizeof(output));
+
+            // Power-on values used by the model
+            regs[R_DEVICEID]   = (0x29C << 2);
+            regs[R_SPICONFIG]  = 0x0AA4;
+            regs[R_GENCONFIG]  = 0x7F00;
+            regs[R_BRDCONFIG]  = 0xFFFF;
+            regs[R_DACPWDWN]   = 0xFFFF;
+
+            _pending_read = false;
+        }
+
+        void load_sync() {
+            for(int ch=0; ch<=15; ch++) {
+                if(regs[R_SYNCCONFIG] & (1 << ch)) output[ch] = buffer[ch];
+            }
+        }
+
+        void set_dac(int ch, uint16_t val) {
+            buffer[ch] = val;
+            regs[R_DAC0 + ch] = val;
+            if(!(regs[R_SYNCCONFIG] & (1 << ch))) output[ch] = val;
+        }
+
+        void write(uint8_t reg, uint16_t val) {
+
+            if(reg >= R_DAC0 && reg <= R_DAC15) {
+                set_dac(reg - R_DAC0, val);
+            }
+            else if(reg == R_BRDCAST) {
+                for(int ch=0; ch<=15; ch++) {
+                    if(regs[R_BRDCONFIG] & (1 << ch)) set_dac(ch, val);
+                }
+            }
+            else if(reg == R_TRIGGER) {
+                if((val & 0x0F) == DEVICE_DEFAULTS_CODE) power_on();
+                else if(val & (1 << TRIGGER_LDAC)) load_sync();
+            }
+            else if(reg != R_NOP && reg != R_DEVICEID && reg != R_STATUS && reg < 0x20) {
+                regs[reg] = val;
+            }
+        }
+
+    public:
+        uint16_t regs[32];
+        uint16_t buffer[16];    // DAC data registers
+        uint16_t output[16];    // What the pins would show
+        uint32_t frames;
+
+        DAC81416_Sim() {
+            frames = 0;
+            _now_us = 0;
+            _reset_level = true;
+            power_on();
+        }
+
+        void begin() {}
+
+        void transfer(const uint8_t *tx, uint8_t *rx, uint8_t len, uint16_t count) {
+
+            for(uint16_t f=0; f<count; f++, tx += len) {
+                uint8_t out[4] = {0, 0, 0, 0};
+
+                if(_pending_read && (regs[R_SPICONFIG] & SDO_EN(1))) {
+                    uint16_t val = regs[_pending_cmd & 0x3F];
+                    out[0] = _pending_cmd;
+                    out[1] = val >> 8;
+                    out[2] = val & 0xFF;
+                }
+
+                if(rx) {
+                    memcpy(rx, out, len < 4 ? len : 4);
+                    rx += len;
+                }
+
+                frames++;
+
+                // Held in reset, SPI is ignored
+                if(!_reset_level || len < DAC81416_FRAME_LEN) {
+                    _pending_read = false;
+                    continue;
+                }
+
+                _pending_read = (tx[0] & 0x80) != 0;
+                _pending_cmd = tx[0];
+
+                if(!_pending_read) write(tx[0] & 0x3F, (tx[1] << 8) | tx[2]);
+            }
+        }
+
+        void pulse_ldac() {
+            load_sync();
+        }
+
+        bool has_ldac() {
+            return true;
+        }
+
+        void set_reset(bool level) {
+            if(!level) power_on();
+            _reset_level = level;
+        }
+
+        bool has_reset() {
+            return true;
+        }
+
+        void delay_ms(uint32_t ms) {
+            _now_us += ms * 1000;
+        }
+
+        uint32_t now_us() {
+            return _now_us;
+        }
+
+        void advance_us(uint32_t us) {
+            _now_us += us;
+        }
+};
+
+#endif
@@ -0,0 +1,148 @@
+/**
+ * DAC81416 trace decoder
+ *
+ *   Turns a binary bus trace into register level events and per operation timing.
+ *
+ *   Build (host):
+ *     g++ -O2 -I../../src trace_decode.cpp ../../src/dac81416_trace.cpp -o trace_decode
+ *
+ *   Usage:
+ *     trace_decode [-s] trace.bin      -s prints the timing summary only
+ *
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include "trace_reader.h"
+
+// Timing per operation, indexed by register (reads use reg + 64)
+struct OpStats {
+    uint32_t count;
+    double frame_us;        // Sum of each frame's share of its transport call
+    uint32_t max_batch_us;
+};
+
+static OpStats stats[128];
+static uint32_t ldac_count, reset_count;
+
+static void add_stat(int op, double frame_us, uint16_t batch_us) {
+    stats[op].count++;
+    stats[op].frame_us += frame_us;
+    if(batch_us > stats[op].max_batch_us) stats[op].max_batch_us = batch_us;
+}
+
+int main(int argc, char **argv) {
+
+    bool summary_only = false;
+    const char *path = 0;
+
+    for(int i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "-s")) summary_only = true;
+        else path = argv[i];
+    }
+
+    if(!path) {
+        fprintf(stderr, "usage: %s [-s] trace.bin\n", argv[0]);
+        return 2;
+    }
+
+    DAC81416_TraceReader trace(path);
+    if(!trace.ok()) return 1;
+
+    // Read command waiting for its data frame, per device
+    int pending[256];
+    double pending_us[256];
+    for(int d=0; d<256; d++) pending[d] = -1;
+
+    uint32_t n = trace.size();
+    uint32_t batch_frames = 1;
+
+    if(!summary_only) printf("%12s %6s %4s  event\n", "time_us", "dur", "dev");
+
+    for(uint32_t i=0; i<n; i++) {
+        const DAC81416_TraceRecord &rec = trace.at(i);
+        uint8_t kind = TRACE_KIND(rec.flags);
+        uint8_t dev = rec.device;
+
+        if(kind == TRACE_LDAC || kind == TRACE_RESET_LOW || kind == TRACE_RESET_HIGH) {
+            if(kind == TRACE_LDAC) ldac_count++;
+            else reset_count++;
+
+            if(!summary_only) {
+                printf("%12lu %6s %4u  %s\n", (unsigned long)rec.timestamp_us, "", dev,
+                       kind == TRACE_LDAC ? "LDAC pulse" :
+                       kind == TRACE_RESET_LOW ? "RESET low" : "RESET high");
+            }
+            continue;
+        }
+
+        // Frames clocked out by the same transport call share its duration
+        if(rec.flags & TRACE_BATCH) {
+            batch_frames = 1;
+            for(uint32_t j=i+1; j<n; j++) {
+                const DAC81416_TraceRecord &next = trace.at(j);
+                if((next.flags & TRACE_BATCH) || next.device != dev ||
+                   next.timestamp_us != rec.timestamp_us) break;
+                batch_frames++;
+            }
+        }
+
+        double frame_us = (double)rec.duration_us / batch_frames;
+        uint8_t cmd = rec.tx[0];
+        uint8_t reg = cmd & 0x3F;
+        uint16_t data = (rec.tx[1] << 8) | rec.tx[2];
+
+        // This frame clocks out the result of the previous read command
+        if(pending[dev] > -1) {
+            if(!summary_only) {
+                printf("%12lu %6u %4u  READ  %-10s ", (unsigned long)rec.timestamp_us,
+                       rec.duration_us, dev, trace_reg_name(pending[dev]));
+                if(rec.flags & TRACE_RX) printf("-> 0x%04X\n", (rec.rx[1] << 8) | rec.rx[2]);
+                else printf("-> (SDO not captured)\n");
+            }
+
+            // A read costs the command frame plus this one
+            add_stat(64 + pending[dev], pending_us[dev] + frame_us, rec.duration_us);
+            pending[dev] = -1;
+
+            // Plain NOP readout frame, nothing else to report
+            if(cmd == 0 && data == 0) continue;
+        }
+
+        if(cmd & 0x80) {
+            pending[dev] = reg;
+            pending_us[dev] = frame_us;
+            continue;
+        }
+
+        if(!summary_only) {
+            printf("%12lu %6u %4u  WRITE %-10s = 0x%04X\n", (unsigned long)rec.timestamp_us,
+                   rec.duration_us, dev, trace_reg_name(reg), data);
+        }
+
+        add_stat(reg, frame_us, rec.duration_us);
+    }
+
+    // Per operation timing
+    printf("\n%-18s %8s %12s %12s\n", "operation", "count", "mean_us", "max_call_us");
+
+    for(int op=0; op<128; op++) {
+        if(!stats[op].count) continue;
+
+        char name[32];
+        snprintf(name, sizeof(name), "%s %s", op < 64 ? "WRITE" : "READ", trace_reg_name(op & 0x3F));
+        printf("%-18s %8lu %12.2f %12lu\n", name, (unsigned long)stats[op].count,
+               stats[op].frame_us / stats[op].count, (unsigned long)stats[op].max_batch_us);
+    }
+
+    printf("%-18s %8lu\n", "LDAC", (unsigned long)ldac_count);
+    printf("%-18s %8lu\n", "RESET edges", (unsigned long)reset_count);
+
+    const DAC81416_TraceHeader *h = trace.header();
+    if(h->head > h->capacity) {
+        printf("\nRing wrapped, oldest %lu records were overwritten\n",
+               (unsigned long)(h->head - h->capacity));
+    }
+
+    return 0;
+}
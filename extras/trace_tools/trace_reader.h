@@ -0,0 +1,85 @@
+#ifndef DAC81416_TRACE_READER_H
+#define DAC81416_TRACE_READER_H
+
+// Includes
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dac81416_trace.h"
+
+/*
+
+Read-only view of a trace file (DAC81416_TraceFile, or a RAM ring dumped
+with DAC81416_TraceLog::dump()). Never append() to it.
+
+*/
+
+class DAC81416_TraceReader : public DAC81416_TraceLog {
+
+    private:
+        void *_map;
+        size_t _map_len;
+
+    public:
+        DAC81416_TraceReader(const char *path) {
+            _map = 0;
+            _map_len = 0;
+
+            int fd = open(path, O_RDONLY);
+            if(fd < 0) return;
+
+            struct stat st;
+            if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(DAC81416_TraceHeader)) {
+                void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(map != MAP_FAILED) {
+                    _map = map;
+                    _map_len = st.st_size;
+                }
+            }
+            close(fd);
+
+            if(!_map) return;
+
+            DAC81416_TraceHeader *h = (DAC81416_TraceHeader *)_map;
+            size_t need = sizeof(DAC81416_TraceHeader) + (size_t)h->capacity * sizeof(DAC81416_TraceRecord);
+
+            if(h->magic != DAC81416_TRACE_MAGIC || h->record_size != sizeof(DAC81416_TraceRecord) ||
+               need > _map_len) {
+                fprintf(stderr, "%s: not a DAC81416 trace\n", path);
+                return;
+            }
+
+            _header = h;
+            _records = (DAC81416_TraceRecord *)((uint8_t *)_map + sizeof(DAC81416_TraceHeader));
+        }
+
+        ~DAC81416_TraceReader() {
+            if(_map) munmap(_map, _map_len);
+        }
+
+        bool ok() {
+            return _header != 0;
+        }
+};
+
+
+// Register names, Table 8-7
+static const char *trace_reg_name(uint8_t reg) {
+    static const char *names[16] = {
+        "NOP", "DEVICEID", "STATUS", "SPICONFIG", "GENCONFIG", "BRDCONFIG",
+        "SYNCCONFIG", "TOGCONFIG0", "TOGCONFIG1", "DACPWDWN", "DACRANGE0",
+        "DACRANGE1", "DACRANGE2", "DACRANGE3", "TRIGGER", "BRDCAST"};
+    static const char *dacs[16] = {
+        "DAC0", "DAC1", "DAC2", "DAC3", "DAC4", "DAC5", "DAC6", "DAC7",
+        "DAC8", "DAC9", "DAC10", "DAC11", "DAC12", "DAC13", "DAC14", "DAC15"};
+
+    reg &= 0x3F;
+    if(reg < 0x10) return names[reg];
+    if(reg < 0x20) return dacs[reg - 0x10];
+    return "?";
+}
+
+#endif
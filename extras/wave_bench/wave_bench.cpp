@@ -0,0 +1,151 @@
+/**
+ * DAC81416 waveform player benchmark
+ *
+ *   Plays a waveform file unpaced through DAC81416_WavePlayer and reports
+ *   sustained samples per second and the page fault rate. The page cache for
+ *   the file is dropped first so the faults are the ones a cold start sees.
+ *
+ *   Without a spidev path the frames go to a null transport, which measures
+ *   the player and library overhead alone.
+ *
+ *   Build (host), from this directory:
+ *     g++ -O2 -I../../src wave_bench.cpp ../../src/dac81416.cpp
+ *         ../../src/dac81416_transport.cpp ../../src/dac81416_spidev.cpp
+ *         ../../src/dac81416_wavefile.cpp -o wave_bench
+ *
+ *   Usage:
+ *     wave_bench [file] [/dev/spidevX.Y]
+ *
+ *   If file does not exist, a 16 channel, 48kHz, 20 second test file is written there
+ *   (default /tmp/dac81416_bench.d8w).
+ *
+**/
+
+#include <math.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "dac81416.h"
+#include "dac81416_spidev.h"
+#include "dac81416_wavefile.h"
+
+#define BENCH_RATE     48000
+#define BENCH_SECONDS  20
+#define BENCH_CHANNELS 16
+
+// Throws frames away, counts them
+class NullTransport : public DAC81416_Transport {
+    public:
+        uint64_t frames;
+
+        NullTransport() { frames = 0; }
+        void begin() {}
+        void transfer(const uint8_t *, uint8_t *, uint8_t, uint16_t count) {
+            frames += count;
+        }
+        void pulse_ldac() {}
+        bool has_ldac() { return false; }
+        void set_reset(bool) {}
+        bool has_reset() { return false; }
+        void delay_ms(uint32_t) {}
+        uint32_t now_us() { return 0; }
+};
+
+static bool make_test_file(const char *path) {
+
+    uint8_t map[BENCH_CHANNELS];
+    DAC81416::ChannelRange ranges[BENCH_CHANNELS];
+
+    for(int ch=0; ch<BENCH_CHANNELS; ch++) {
+        map[ch] = ch;
+        ranges[ch] = DAC81416::B_10;
+    }
+
+    DAC81416_WaveWriter writer;
+    if(!writer.open(path, BENCH_RATE, BENCH_CHANNELS, map, ranges)) return false;
+
+    // One sine per channel, 10Hz apart
+    uint16_t frame[BENCH_CHANNELS];
+
+    for(uint32_t n=0; n<(uint32_t)BENCH_RATE * BENCH_SECONDS; n++) {
+        for(int ch=0; ch<BENCH_CHANNELS; ch++) {
+            frame[ch] = 0x8000 + 30000 * sin(2 * M_PI * 10 * (ch + 1) * n / BENCH_RATE);
+        }
+        if(!writer.write_frame(frame)) return false;
+    }
+
+    return writer.close();
+}
+
+static double now_s() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+
+    const char *path = argc > 1 ? argv[1] : "/tmp/dac81416_bench.d8w";
+    const char *spidev = argc > 2 ? argv[2] : 0;
+
+    if(access(path, R_OK) != 0) {
+        printf("Writing test file %s\n", path);
+        if(!make_test_file(path)) {
+            fprintf(stderr, "%s: could not write test file\n", path);
+            return 1;
+        }
+    }
+
+    // Drop cached pages so playback starts cold
+    int fd = open(path, O_RDONLY);
+    if(fd > -1) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+
+    NullTransport null_bus;
+    DAC81416_Spidev *spi_bus = spidev ? new DAC81416_Spidev(spidev, 30000000) : 0;
+    DAC81416 dac(spi_bus ? (DAC81416_Transport *)spi_bus : &null_bus);
+
+    if(spi_bus && !spi_bus->ok()) {
+        fprintf(stderr, "%s: could not open\n", spidev);
+        return 1;
+    }
+
+    DAC81416_WavePlayer player(&dac);
+    if(!player.open(path)) {
+        fprintf(stderr, "%s: not a waveform file\n", path);
+        return 1;
+    }
+
+    const DAC81416_WaveHeader *h = player.header();
+    double bytes = (double)h->frames * h->channels * 2;
+
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    double start = now_s();
+
+    uint64_t frames = player.play(false);
+
+    double took = now_s() - start;
+    getrusage(RUSAGE_SELF, &after);
+
+    long minor = after.ru_minflt - before.ru_minflt;
+    long major = after.ru_majflt - before.ru_majflt;
+
+    printf("File:          %s, %u channels, %u Hz, %llu frames (%.1f MB)\n", path, h->channels,
+           h->sample_rate_hz, (unsigned long long)h->frames, bytes / 1e6);
+    printf("Played:        %llu frames in %.3f s (%.1fx real time)\n", (unsigned long long)frames,
+           took, frames / (double)h->sample_rate_hz / took);
+    printf("Samples/s:     %.0f\n", frames * h->channels / took);
+    printf("Page faults:   %ld minor, %ld major, %.2f per MB\n", minor, major,
+           (minor + major) / (bytes / 1e6));
+
+    if(!spi_bus) printf("SPI frames:    %llu (null transport)\n", (unsigned long long)null_bus.frames);
+
+    delete spi_bus;
+    return 0;
+}
@@ -1,22 +1,36 @@
 #include "dac81416.h"
 
+#if defined(ARDUINO)
 // DAC constructor 
-DAC81416::DAC81416(int cspin, int rstpin, int ldacpin, SPIClass *spi, uint32_t spi_clock_hz) {
-    _cs_pin = cspin;
-    _spi = spi;
-
-    // RESET pin setup
-    if(rstpin > -1) _rst_pin = rstpin;
-    
-    // LDAC pin setup
-    if(ldacpin > -1) _ldac_pin = ldacpin;
-    
-    _spi_settings = SPISettings(spi_clock_hz, MSBFIRST, SPI_MODE0);
-
-    pinMode(_cs_pin, OUTPUT);
-    digitalWrite(_rst_pin, HIGH);
-
-    _spi->begin();
+DAC81416::DAC81416(int cspin, int rstpin, int ldacpin, SPIClass *spi, uint32_t spi_clock_hz)
+    : _arduino_bus(cspin, rstpin, ldacpin, spi, spi_clock_hz) {
+    _bus = &_arduino_bus;
+    _crc_en = false;
+    _shadow_valid = 0;
+    _robust = false;
+    _budget_us = 0;
+    _last_recovery_us = 0;
+    _recoveries = 0;
+    _cfg_errors = 0;
+    _last_cfg_error = -1;
+
+    _bus->begin();
+}
+#endif
+
+// DAC constructor on a caller supplied transport
+DAC81416::DAC81416(DAC81416_Transport *bus) {
+    _bus = bus;
+    _crc_en = false;
+    _shadow_valid = 0;
+    _robust = false;
+    _budget_us = 0;
+    _last_recovery_us = 0;
+    _recoveries = 0;
+    _cfg_errors = 0;
+    _last_cfg_error = -1;
+
+    _bus->begin();
 }
 
 // CRC calculator
@@ -38,34 +52,12 @@ inline uint8_t DAC81416::calculateCRC(uint8_t* data, uint8_t length) {
     return crc;
 }
 
-// Chip Select
-inline void DAC81416::cs_on() {
-    digitalWrite(_cs_pin, LOW);
-}
-
-inline void DAC81416::cs_off() {
-    digitalWrite(_cs_pin, HIGH);
-}
-
-/*
-
-Table 6-1
-
-Active low synchronization signal. When the LDAC pin is low, the DAC outputs of those channels
-configured in synchronous mode are updated simultaneously. Connect to VIO if unused.
-
-Table 6-8
-
-LDAC low time   VIO 1.7V to 2.7V	40ns
-LDAC low time   VIO 2.7V to 5.5V	20ns
-
-*/
-
+// LDAC pulse, see DAC81416_ArduinoSPI::pulse_ldac() for timing
+// Without an LDAC line the same load is done in software through TRIGGER
 void DAC81416::sync()
 {
-	digitalWrite(_ldac_pin, LOW);
-	NOP;NOP;
-	digitalWrite(_ldac_pin, HIGH);
+	if(_bus->has_ldac()) _bus->pulse_ldac();
+	else trigger_ldac();
 }
 
 /*
@@ -91,8 +83,54 @@ int DAC81416::get_versionid()
   uint16_t deviceV = read_reg(R_DEVICEID);   
   
   // DAC81416 will return 2 bits version ID (0 on DAC81416EVM)
-  return deviceV &= 0x02;
+  return deviceV & 0x03;
+}
+
+//****************** Bus discovery ******************//
+bool DAC81416::probe(DAC81416_Transport *bus, DAC81416_Probe *result) {
+
+    // Read command, then a NOP frame to clock DEVICEID out
+    uint8_t tx[2*DAC81416_FRAME_LEN] = {(uint8_t)(RREG | R_DEVICEID), 0x00, 0x00,
+                                        0x00, 0x00, 0x00};
+    uint8_t rx[2*DAC81416_FRAME_LEN] = {0};
+
+    bus->transfer(tx, rx, DAC81416_FRAME_LEN, 2);
+
+    uint16_t word = (rx[DAC81416_FRAME_LEN + 1] << 8) | rx[DAC81416_FRAME_LEN + 2];
+
+    // Same test as is_alive()
+    result->alive = !(word == 0xFFFF || word == 0x0000);
+    result->deviceid = result->alive ? word >> 2 : 0;
+    result->versionid = result->alive ? word & 0x03 : 0;
+
+    return result->alive;
+}
+
+#if defined(ARDUINO)
+uint8_t DAC81416::probe_bus(const int *cs_pins, uint8_t count, DAC81416_Probe *table,
+                            SPIClass *spi, uint32_t spi_clock_hz) {
+
+    // Every CS must be HIGH before the first frame, or two DACs could drive SDO
+    for(uint8_t i=0; i<count; i++) {
+        pinMode(cs_pins[i], OUTPUT);
+        digitalWrite(cs_pins[i], HIGH);
+    }
+
+    spi->begin();
+
+    uint8_t found = 0;
+
+    for(uint8_t i=0; i<count; i++) {
+        // Pins are already set up, no begin() needed
+        DAC81416_ArduinoSPI bus(cs_pins[i], -1, -1, spi, spi_clock_hz);
+
+        table[i].cs = cs_pins[i];
+        if(probe(&bus, &table[i])) found++;
+    }
+
+    return found;
 }
+#endif
 
 bool DAC81416::is_alive()
 {
@@ -110,31 +148,178 @@ bool DAC81416::is_alive()
 	}
 }
 
+//****************** Robust mode ******************//
+/*
+
+Every register write is remembered in _shadow (except the trigger style
+registers), so after a glitch or a reset the device can be put back exactly
+as it was without the caller replaying its setup.
+
+DACRANGE can't be read back, so those writes are only checked by making sure
+the bus is still in sync (DEVICEID, same test as is_alive()).
+
+*/
+
+// Registers that hold state, bit n = register n
+#define SHADOW_REGS  (0xFFFF0000UL | (1UL << R_SPICONFIG) | (1UL << R_GENCONFIG) | \
+                      (1UL << R_BRDCONFIG) | (1UL << R_SYNCCONFIG) | (1UL << R_TOGCONFIG0) | \
+                      (1UL << R_TOGCONFIG1) | (1UL << R_DACPWDWN) | (1UL << R_DACRANGE0) | \
+                      (1UL << R_DACRANGE1) | (1UL << R_DACRANGE2) | (1UL << R_DACRANGE3))
+
+void DAC81416::shadow(uint8_t reg, uint16_t wdata) {
+
+    if(reg > 31 || !(SHADOW_REGS & (1UL << reg))) return;
+
+    _shadow[reg] = wdata;
+    _shadow_valid |= (1UL << reg);
+}
+
+void DAC81416::set_robust(bool state, uint32_t budget_us) {
+    _robust = state;
+    _budget_us = budget_us;
+}
+
+bool DAC81416::verify(uint8_t reg, uint16_t wdata) {
+
+    // No SDO, nothing can be read back
+    uint16_t spiconfig = (_shadow_valid & (1UL << R_SPICONFIG)) ? _shadow[R_SPICONFIG] : SPICONFIG;
+    if(!(spiconfig & SDO_EN(1))) return true;
+
+    // DACRANGE is write only: the bus is still in sync and the word is the one
+    // get_range() reports, the data bits that landed cannot be checked
+    if(reg >= R_DACRANGE0 && reg <= R_DACRANGE3) {
+        return is_alive() && wdata == KNOWN_DACRANGE[reg - R_DACRANGE0];
+    }
+
+    return read_reg(reg) == wdata;
+}
+
+bool DAC81416::write_cfg(uint8_t reg, uint16_t wdata) {
+
+    if(!_robust) {
+        write_reg(reg, wdata);
+        return true;
+    }
+
+    uint32_t start = _bus->now_us();
+
+    do {
+        write_reg(reg, wdata);
+        if(verify(reg, wdata)) return true;
+
+        // Lost sync rather than a single bad frame
+        if(!is_alive()) resync();
+
+    } while(_bus->now_us() - start < _budget_us);
+
+    _cfg_errors++;
+    _last_cfg_error = reg;
+
+    return false;
+}
+
+// Registers restored by resync(), config first, outputs last
+static const uint8_t RESTORE_ORDER[] = {
+    R_SPICONFIG, R_GENCONFIG, R_BRDCONFIG, R_SYNCCONFIG, R_TOGCONFIG0, R_TOGCONFIG1,
+    R_DACPWDWN, R_DACRANGE0, R_DACRANGE1, R_DACRANGE2, R_DACRANGE3,
+    R_DAC0, R_DAC1, R_DAC2, R_DAC3, R_DAC4, R_DAC5, R_DAC6, R_DAC7,
+    R_DAC8, R_DAC9, R_DAC10, R_DAC11, R_DAC12, R_DAC13, R_DAC14, R_DAC15};
+
+bool DAC81416::resync() {
+
+    uint32_t start = _bus->now_us();
+    uint16_t spiconfig = (_shadow_valid & (1UL << R_SPICONFIG)) ? _shadow[R_SPICONFIG] : SPICONFIG;
+
+    // A slipped frame usually only needs SPICONFIG again
+    write_reg(R_SPICONFIG, spiconfig);
+
+    if(!is_alive() && _bus->has_reset()) {
+        reset();
+        _bus->delay_ms(1);
+        write_reg(R_SPICONFIG, spiconfig);
+    }
+
+    bool ok = is_alive();
+
+    if(ok) {
+        // Everything in one transport call
+        uint8_t frames[sizeof(RESTORE_ORDER) * DAC81416_FRAME_LEN];
+        uint8_t n = 0;
+
+        for(uint8_t i=0; i<sizeof(RESTORE_ORDER); i++) {
+            uint8_t reg = RESTORE_ORDER[i];
+            if(!(_shadow_valid & (1UL << reg))) continue;
+
+            frames[n*DAC81416_FRAME_LEN + 0] = reg;
+            frames[n*DAC81416_FRAME_LEN + 1] = _shadow[reg] >> 8;
+            frames[n*DAC81416_FRAME_LEN + 2] = _shadow[reg] & 0xFF;
+            n++;
+        }
+
+        if(n) _bus->transfer(frames, 0, DAC81416_FRAME_LEN, n);
+
+        // SYNC channels only show their restored value after LDAC
+        sync();
+    }
+
+    _last_recovery_us = _bus->now_us() - start;
+    _recoveries++;
+
+    return ok;
+}
+
+bool DAC81416::check() {
+
+    // A power glitch leaves the device alive but back at its defaults
+    if(is_alive() && (!(_shadow_valid & (1UL << R_SPICONFIG)) ||
+                      read_reg(R_SPICONFIG) == _shadow[R_SPICONFIG])) return true;
+
+    return resync();
+}
+
+uint32_t DAC81416::get_last_recovery_us() {
+    return _last_recovery_us;
+}
+
+uint16_t DAC81416::get_recovery_count() {
+    return _recoveries;
+}
+
+uint16_t DAC81416::get_cfg_error_count() {
+    return _cfg_errors;
+}
+
+int DAC81416::get_last_cfg_error() {
+    return _last_cfg_error;
+}
+
 int DAC81416::init(bool CRC, ChannelRange default_channelrange) {
+
+    _cfg_errors = 0;
+    _last_cfg_error = -1;
         
-    if(_rst_pin!=-1) {
-        pinMode(_rst_pin, OUTPUT);
-        digitalWrite(_rst_pin, LOW);
-        delay(1); 
-        digitalWrite(_rst_pin, HIGH); 
-        delay(1);
+    if(_bus->has_reset()) {
+        _bus->set_reset(false);
+        _bus->delay_ms(1); 
+        _bus->set_reset(true); 
+        _bus->delay_ms(1);
     }
 
     // Enable SDO
     write_reg(R_SPICONFIG, 0x0004);
-	  delay(1);
+	  _bus->delay_ms(1);
    
     // Set SPICONFIG
 	if (CRC == 0)
 	{		
-		write_reg(R_SPICONFIG, SPICONFIG);
+		write_cfg(R_SPICONFIG, SPICONFIG);
 	}
 	else
 	{
 		// Don't use CRC Mode, not implemented
 		//write_reg(R_SPICONFIG, CRC_SPICONFIG);
 	}
-	delay(1);
+	_bus->delay_ms(1);
 
     // Set the default channel RANGES
   	for(int i=0; i<=15; i++)
@@ -148,25 +333,23 @@ int DAC81416::init(bool CRC, ChannelRange default_channelrange) {
 
 
 // SPAM THE NON-CRC SPICONFIG UNTIL IT WORKS - NEED TO FIGURE OUT CRC ISSUES
+// Takes up to 25s, for a bounded recovery use set_robust() / resync()
 void DAC81416::fix() {
 
 	//TRY EVERY CRC, FOR SOME REASON WITH THE SAME DATA IT WANTS A DIFFERENT CRC EACH TIME I TRY IT
 	for(int i=0; i<=255; i++) {
-    _spi->beginTransaction(_spi_settings);
-    cs_on();
-    NOP;
-    _spi->transfer(0x03); // SPICONFIG Register
-    _spi->transfer(0x08); // SPICONFIG Default
-    _spi->transfer(0x86); // SPICONFIG Default
-	_spi->transfer(i); 
-    tcsh_delay();
-    cs_off();
-    _spi->endTransaction();
-	delay(100);
+    uint8_t frame[4] = {0x03,        // SPICONFIG Register
+                        0x08,        // SPICONFIG Default
+                        0x86,        // SPICONFIG Default
+                        (uint8_t)i};
+    _bus->transfer(frame, 0, sizeof(frame), 1);
+	_bus->delay_ms(100);
+#if defined(ARDUINO)
 	Serial.print("Trying... ");
 	Serial.println(i,HEX);
 	Serial.print("Result: ");
 	Serial.println(get_deviceid(),HEX);
+#endif
 	
 	if(get_deviceid() == 0x29C){ break; };
 		//STOP ONCE IT'S FIXED (81416)
@@ -177,36 +360,22 @@ void DAC81416::write_reg(uint8_t reg, uint16_t wdata) {
     uint8_t lsb = ((uint16_t)wdata >> 0) & 0xFF;
     uint8_t msb = ((uint16_t)wdata >> 8) & 0xFF;
 
-    _spi->beginTransaction(_spi_settings);
-    cs_on();
-    NOP;
-    _spi->transfer(reg);
-    _spi->transfer(msb);
-    _spi->transfer(lsb);
-    tcsh_delay();
-    cs_off();
-    _spi->endTransaction();
+    uint8_t frame[DAC81416_FRAME_LEN] = {reg, msb, lsb};
+    _bus->transfer(frame, 0, DAC81416_FRAME_LEN, 1);
+
+    shadow(reg, wdata);
 }
 
 
+// Read command frame, then a NOP frame to clock the data out
 uint16_t DAC81416::read_reg(uint8_t reg) {
-    uint8_t buf[3]; // 15-0
-
-    _spi->beginTransaction(_spi_settings);
-    cs_on();
-    _spi->transfer( (RREG | reg) );
-    _spi->transfer(0x00);
-    _spi->transfer(0x00);
-    tcsh_delay();
-    cs_off();
-
-    cs_on();
-    buf[0] = _spi->transfer(0x00);
-    buf[1] = _spi->transfer(0x00);
-    buf[2] = _spi->transfer(0x00);
-    tcsh_delay();
-    cs_off();
-    _spi->endTransaction();
+    uint8_t tx[2*DAC81416_FRAME_LEN] = {(uint8_t)(RREG | reg), 0x00, 0x00,
+                                        0x00, 0x00, 0x00};
+    uint8_t rx[2*DAC81416_FRAME_LEN] = {0};
+
+    _bus->transfer(tx, rx, DAC81416_FRAME_LEN, 2);
+
+    uint8_t *buf = rx + DAC81416_FRAME_LEN; // 15-0
 
     // check buf[0]
 
@@ -216,39 +385,32 @@ uint16_t DAC81416::read_reg(uint8_t reg) {
 
 // TESTING, VERY MUCH NOT WORKING
 uint16_t DAC81416::read_reg_crc(uint8_t reg) {
-    uint8_t buf[4]; // 31-0	
 	
-	byte data[] = {(0x80 | reg), 0x00, 0x00};
-	byte dataSize = sizeof(data) / sizeof(data[0]);
+	uint8_t data[] = {(uint8_t)(0x80 | reg), 0x00, 0x00};
+	uint8_t dataSize = sizeof(data) / sizeof(data[0]);
 	
 	uint8_t CRC = calculateCRC(data, dataSize);
 	
-    _spi->beginTransaction(_spi_settings);
-    cs_on();
-    _spi->transfer( (0x80 | reg) );
-    _spi->transfer(0x00); // Don't care values
-    _spi->transfer(0x00); // Don't care values
-	_spi->transfer(CRC);  // Calculated CRC
-    tcsh_delay();
-    cs_off();
-
-    cs_on();
-    buf[0] = _spi->transfer(0x00);
-    buf[1] = _spi->transfer(0x00);
-    buf[2] = _spi->transfer(0x00);
-	buf[3] = _spi->transfer(0x00);
-    tcsh_delay();
-    cs_off();
-    _spi->endTransaction();
+    uint8_t tx[8] = {(uint8_t)(0x80 | reg),
+                     0x00, 0x00, // Don't care values
+                     CRC,        // Calculated CRC
+                     0x00, 0x00, 0x00, 0x00};
+    uint8_t rx[8];
+
+    _bus->transfer(tx, rx, 4, 2);
+
+    uint8_t *buf = rx + 4; // 31-0	
 
     // buf[0] will be the CRC
 	// buf[1] and buf[2] are the data
 	// buf[3] is address, CRC bit and RW bit	
 
+#if defined(ARDUINO)
 	Serial.println(buf[0],HEX);
 	Serial.println(buf[1],HEX);
 	Serial.println(buf[2],HEX);
 	Serial.println(buf[3],HEX);
+#endif
 
     uint16_t res = ((buf[2] << 8) | buf[1]);
     return res;
@@ -308,8 +470,8 @@ void DAC81416::set_ch_LDAC_enabled(int ch, bool state) { // true/false = power O
     uint16_t res = read_reg(R_SYNCCONFIG);
     
     // if state==true, power up the channel
-    if(state) write_reg(R_SYNCCONFIG, res &= ~(1 << ch) );
-    else write_reg(R_SYNCCONFIG, res |= (1 << ch) );
+    if(state) write_cfg(R_SYNCCONFIG, res &= ~(1 << ch) );
+    else write_cfg(R_SYNCCONFIG, res |= (1 << ch) );
 
 }
 
@@ -322,8 +484,8 @@ bool DAC81416::get_ch_LDAC_enabled(int ch) {
 
 //************** Set internal reference **************//
 void DAC81416::set_int_reference(bool state) {
-    if(state) write_reg(R_GENCONFIG, (0 << 14) ); // Turn on 2.5V reference
-    else write_reg(R_GENCONFIG, (1 << 14) ); // Shutdown 2.5V reference
+    if(state) write_cfg(R_GENCONFIG, (0 << 14) ); // Turn on 2.5V reference
+    else write_cfg(R_GENCONFIG, (1 << 14) ); // Shutdown 2.5V reference
 }
 
 //************** Get internal reference **************//
@@ -336,21 +498,30 @@ int DAC81416::get_int_reference() {
 //**************** Set Range of a channel ***************//
 void DAC81416::set_range(int ch, ChannelRange range) {
 
+    if(ch < 0 || ch > 15) return;
+
 	// Calculate which REGISTER from Channel Number 0 to 15;
 	int reg = ch / 4;
 	
 	// REGISTER address to be stored in here
 	int DAC_REGISTER = R_DACRANGE3 - reg;
 	
-	// From original library - Calculate the bits needed to configure register
-    uint16_t mask = (0xffff >> (16-4)) << 4*ch;
-    uint16_t write = (KNOWN_DACRANGE[DAC_REGISTER - 0x0A] & ~mask) | (( range << 4*ch )&mask);
+	// Each register holds 4 channels, one nibble per channel
+    uint16_t mask = (0xffff >> (16-4)) << 4*(ch%4);
+    uint16_t write = (KNOWN_DACRANGE[DAC_REGISTER - 0x0A] & ~mask) | (( range << 4*(ch%4) )&mask);
+
+    // Can't be read back, so catch a wrong word here before it is sent
+    if(((write >> 4*(ch%4)) & 0xF) != range) {
+        _cfg_errors++;
+        _last_cfg_error = DAC_REGISTER;
+        return;
+    }
 	
 	// Update saved DACRANGE state
     KNOWN_DACRANGE[DAC_REGISTER - 0x0A] = write;		
 			
 	// Write to SPI
-    write_reg(DAC_REGISTER, write);
+    write_cfg(DAC_REGISTER, write);
 }
 
 // Only gets what the MCU has set this BOOT
@@ -359,14 +530,14 @@ int DAC81416::get_range(int ch) {
 	// Calculate which REGISTER from Channel Number 0 to 15;
 	int reg = ch / 4;
 	
-	// REGISTER address to be stored in here
-	int DAC_REGISTER = R_DACRANGE0 + reg;
+	// REGISTER address to be stored in here, same mapping as set_range()
+	int DAC_REGISTER = R_DACRANGE3 - reg;
 	
 	// Select correct known DAC range config from teh array using channel register	
 	int dacRangeIndex = DAC_REGISTER - 0x0A;
 	
 	// Get it
-	uint8_t val = (KNOWN_DACRANGE[dacRangeIndex] >> 4*ch) & (0xF);
+	uint8_t val = (KNOWN_DACRANGE[dacRangeIndex] >> 4*(ch%4)) & (0xF);
 	
 	// Return it
     return val;
@@ -382,6 +553,32 @@ data register data to the BRDCAST one
 
 */
 
+//************ Write values to several channels ***********//
+// One transport call for the whole batch, CS toggles per frame
+void DAC81416::set_out_batch(const uint8_t *channels, const uint16_t *values, uint8_t count) {
+    uint8_t frames[16*DAC81416_FRAME_LEN];
+
+    while(count) {
+        uint8_t n = count < 16 ? count : 16;
+        uint8_t *f = frames;
+
+        for(uint8_t i=0; i<n; i++) {
+            *f++ = R_DAC0 + channels[i];
+            *f++ = (values[i] >> 8) & 0xFF;
+            *f++ = values[i] & 0xFF;
+
+            shadow(R_DAC0 + channels[i], values[i]);
+        }
+
+        _bus->transfer(frames, 0, DAC81416_FRAME_LEN, n);
+
+        channels += n;
+        values += n;
+        count -= n;
+    }
+}
+
+
 //************ Write value to broadcast channels ***********//
 void DAC81416::set_out_broadcast(uint16_t val) {
 	
@@ -419,7 +616,7 @@ void DAC81416::set_sync(int ch, SyncMode mode) {
     else read &= ~(1UL << ch);
 	
 	// Write the register back
-    write_reg(R_SYNCCONFIG, read);
+    write_cfg(R_SYNCCONFIG, read);
 	
     //Serial.print("sync wrote -> "); Serial.println(read, HEX);
 }
@@ -515,9 +712,9 @@ A device hardware reset event is initiated by a minimum 500 ns logic low on the
 */
 void DAC81416::reset()
 {  
-  digitalWrite(_rst_pin, LOW);
-  delay(1);
-  digitalWrite(_rst_pin, HIGH);
+  _bus->set_reset(false);
+  _bus->delay_ms(1);
+  _bus->set_reset(true);
 }
 
 
@@ -617,6 +814,7 @@ where:
 • V_TEMPOUT is the temperature monitor output voltage
 
 */
+#if defined(ARDUINO)
 float DAC81416::get_temp(int pin, float ref)
 {
    int sensorValue = analogRead(pin);
@@ -625,5 +823,6 @@ float DAC81416::get_temp(int pin, float ref)
   
    return temperature;
 }
+#endif
 
 
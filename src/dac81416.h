@@ -1,8 +1,10 @@
+#ifndef DAC81416_H
+#define DAC81416_H
+
 // Includes
 
 #include <stdint.h>
-#include "Arduino.h"
-#include "SPI.h"
+#include "dac81416_transport.h"
 
 
 // Registers	Table 8-7
@@ -58,6 +60,11 @@
 
 #define DEVICE_DEFAULTS_CODE	0xA
 
+// DEVICEID >> 2, Table 8-10
+#define DACID_81416 0x29C
+#define DACID_71416 0x28C
+#define DACID_61416 0x24C
+
 // CRC MODES
 #define CRC_DISABLE		0
 #define CRC_ENABLE		1
@@ -65,32 +72,29 @@
 // DAC READ MASK
 #define RREG 0xC0
 
-// NOP MACRO	62.5ns on 16MHz
-#define NOP __asm__("nop\n\t")
+
+// One slot of a bus scan, see DAC81416::probe()
+struct DAC81416_Probe {
+    int cs;
+    bool alive;
+    uint16_t deviceid;   // DEVICEID >> 2, DACID_81416 etc, 0 if nothing answered
+    uint8_t versionid;
+};
 
 
 class DAC81416 {   
   
     private:
-        SPIClass *_spi;
-        SPISettings _spi_settings;
-        
-        // pins
-        int _cs_pin;
-        int _rst_pin;
-        int _ldac_pin;	
+#if defined(ARDUINO)
+        // Used by the SPIClass constructor
+        DAC81416_ArduinoSPI _arduino_bus;
+#endif
+
+        // Frames, pins and time all go through here
+        DAC81416_Transport *_bus;
 		
 		bool _crc_en;
 
-        inline void cs_on();
-        inline void cs_off();
-                
-        // Might not need NOP, just calling the SPI function is probably delay enough
-        inline void tcsh_delay() {
-            //delayMicroseconds(1);
-			      NOP;
-        }
-
         // SPI functions
         void write_reg(uint8_t reg, uint16_t wdata);
 		void write_reg_crc(uint8_t reg, uint16_t wdata);
@@ -107,6 +111,28 @@ class DAC81416 {
         // Have to keep track of individual channel ranges manually
         uint16_t KNOWN_DACRANGE[4] = {0,0,0,0};
 
+        // Last value written to each register, restored by resync()
+        uint16_t _shadow[32];
+        uint32_t _shadow_valid;
+
+        // Robust mode
+        bool _robust;
+        uint32_t _budget_us;
+        uint32_t _last_recovery_us;
+        uint16_t _recoveries;
+
+        // Config writes that did not verify within the budget, and the last register that failed
+        uint16_t _cfg_errors;
+        int _last_cfg_error;
+
+        void shadow(uint8_t reg, uint16_t wdata);
+
+        // Check a write landed, readback or bus sanity for write only registers
+        bool verify(uint8_t reg, uint16_t wdata);
+
+        // Critical config write, verified and retried in robust mode
+        bool write_cfg(uint8_t reg, uint16_t wdata);
+
     public:
     
 		void fix();
@@ -134,6 +160,7 @@ class DAC81416 {
         enum SyncMode {ASYNC, SYNC};
 		
 		// Pulls LDAC Low to Sync for SYNC SyncMode pins
+		// Falls back to trigger_ldac() when no LDAC line is connected
 		void sync ();
 
         // LDAC Sync Config
@@ -148,11 +175,21 @@ class DAC81416 {
 		// CONFIG with CRC
 		uint16_t CRC_SPICONFIG = TEMPALM_EN(1) | DACBUSY_EN(0) | CRCALM_EN(1) | (0 << 8) | (1 << 7) | SFTTOG_EN(0) | DEV_PWDWN(0) | CRC_EN(1) | STR_EN(0) | SDO_EN(1) | FSDO(1) | 0 << 1;
 
+#if defined(ARDUINO)
         // DAC Constructor
         DAC81416(int cspin, int rstpin = -1, int ldacpin = -1,
                  SPIClass *spi = &SPI, uint32_t spi_clock_hz=8000000);
+#endif
+
+        // DAC Constructor on any transport (e.g. DAC81416_Spidev on Linux)
+        DAC81416(DAC81416_Transport *bus);
+
+        // Transport this DAC talks through
+        DAC81416_Transport *get_transport() { return _bus; }
 
         // Init function to setup the DAC
+        // Clears the config error count, in robust mode get_cfg_error_count() == 0
+        // afterwards means every verified write landed
         int init(bool CRC, ChannelRange default_channelrange);
 
         // Set DAC channel power state
@@ -182,6 +219,10 @@ class DAC81416 {
         // Write 16-bit output value
         void set_out(int ch, uint16_t val);
 		
+		// Write 16-bit output values to several channels in one batch
+		// channels[i] gets values[i]
+        void set_out_batch(const uint8_t *channels, const uint16_t *values, uint8_t count);
+
 		// Write 16-bit output value
         void set_out_broadcast(uint16_t val);
 
@@ -209,6 +250,29 @@ class DAC81416 {
         // Check Alive using R_DEVICEID
     	bool is_alive();
 
+        // Robust mode: SPICONFIG, GENCONFIG, SYNCCONFIG and range writes are
+        // verified and retried for up to budget_us, loss of sync triggers resync()
+        // SPICONFIG, GENCONFIG and SYNCCONFIG are read back. DACRANGE is write only,
+        // it only gets a bus sync check, corrupted data bits are not detected
+        void set_robust(bool state, uint32_t budget_us = 5000);
+
+        // Bring a DAC that lost sync back and restore the last written config and outputs
+        // Hardware reset only if re-sending SPICONFIG is not enough
+        bool resync();
+
+        // is_alive() and SPICONFIG as written, resync() if not. Call periodically in robust mode
+        bool check();
+
+        // Time the last resync() took, and how many there have been
+        uint32_t get_last_recovery_us();
+        uint16_t get_recovery_count();
+
+        // Config writes that failed verification since init(), and the register of
+        // the last one (-1 if none). Only robust mode verifies, apart from a range
+        // word that does not hold the requested range, which is never sent in any mode
+        uint16_t get_cfg_error_count();
+        int get_last_cfg_error();
+
         // Reset
         void reset();
 
@@ -218,10 +282,59 @@ class DAC81416 {
         // Version ID
         int get_versionid();
 
+        // Non-destructive presence check: one DEVICEID read, no reset, no config
+        // Relies on SDO being enabled, which it is after power-on
+        static bool probe(DAC81416_Transport *bus, DAC81416_Probe *result);
+
+#if defined(ARDUINO)
+        // Probe every CS pin in cs_pins, fills table[0..count-1], returns how many answered
+        static uint8_t probe_bus(const int *cs_pins, uint8_t count, DAC81416_Probe *table,
+                                 SPIClass *spi = &SPI, uint32_t spi_clock_hz = 8000000);
+#endif
+
         // Status
         int get_status();
     	
+#if defined(ARDUINO)
 		// Get temperature
     	float get_temp(int pin, float ref);
+#endif
 
 };
+
+
+//****************** Bus session ******************//
+/*
+
+While a session is alive every DAC on that bus reuses one SPI transaction
+(beginTransaction() / endTransaction() once), only CS toggles per frame.
+Sessions nest. Keep them short, the transaction may mask interrupts.
+
+    {
+        DAC81416_BusSession session(dac);
+        dac.set_range(0, DAC81416::B_10);
+        dac.set_out(0, 0x8000);
+        dac2.set_out(0, 0x8000);    // Same SPI and clock, shares the session
+    }
+
+*/
+class DAC81416_BusSession {
+
+    private:
+        DAC81416_Transport *_bus;
+
+        // Not copyable
+        DAC81416_BusSession(const DAC81416_BusSession &);
+        DAC81416_BusSession &operator=(const DAC81416_BusSession &);
+
+    public:
+        DAC81416_BusSession(DAC81416 &dac) : _bus(dac.get_transport()) {
+            _bus->begin_session();
+        }
+
+        ~DAC81416_BusSession() {
+            _bus->end_session();
+        }
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "dac81416_dds.h"
+
+#if !defined(ARDUINO)
+#define PROGMEM
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#endif
+
+// One period of sine, 256 entries, +-32767
+static const int16_t DDS_SINE[DDS_TABLE_SIZE] PROGMEM = {
+         0,    804,   1608,   2410,   3212,   4011,   4808,   5602,   6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+     12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,  18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+     23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,  27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+     30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,  32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+     32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,  32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+     30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,  27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+     23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,  18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+     12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,   6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+         0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,  -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530, -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+    -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790, -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+    -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971, -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285, -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+    -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683, -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+    -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868, -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,  -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804
+};
+
+// DDS constructor
+DAC81416_DDS::DAC81416_DDS(DAC81416 *dac, float tick_hz) {
+    _dac = dac;
+    _tick_hz = tick_hz;
+    _interpolate = true;
+    _table = DDS_SINE;
+    _running = 0;
+
+    for(int ch=0; ch<=15; ch++) {
+        _phase[ch] = 0;
+        _step[ch] = 0;
+        _amplitude[ch] = 0;
+        _offset[ch] = 0x8000;
+        _phase_offset[ch] = 0;
+        _wave[ch] = SINE;
+    }
+}
+
+void DAC81416_DDS::set_table(const int16_t *table) {
+    _table = table;
+}
+
+void DAC81416_DDS::set_interpolation(bool state) {
+    _interpolate = state;
+}
+
+//**************** Channel setup ***************//
+void DAC81416_DDS::start(int ch, Waveform wave, float freq_hz, uint16_t amplitude, uint16_t offset) {
+
+    _wave[ch] = wave;
+    _amplitude[ch] = amplitude > 32767 ? 32767 : amplitude;
+    _offset[ch] = offset;
+    set_frequency(ch, freq_hz);
+
+    // Outputs only move on LDAC so all channels update together
+    _dac->set_sync(ch, DAC81416::SYNC);
+
+    _running |= (1 << ch);
+}
+
+void DAC81416_DDS::stop(int ch) {
+    _running &= ~(1 << ch);
+}
+
+// Tuning word = freq / tick rate * 2^32
+void DAC81416_DDS::set_frequency(int ch, float freq_hz) {
+    _step[ch] = (uint32_t)(freq_hz / _tick_hz * 4294967296.0);
+}
+
+void DAC81416_DDS::set_phase(int ch, uint16_t phase) {
+
+    // Move the accumulator by the difference so the other channels keep their relation
+    _phase[ch] += ((uint32_t)(uint16_t)(phase - _phase_offset[ch])) << 16;
+    _phase_offset[ch] = phase;
+}
+
+void DAC81416_DDS::reset_phase() {
+    for(int ch=0; ch<=15; ch++) _phase[ch] = ((uint32_t)_phase_offset[ch]) << 16;
+}
+
+void DAC81416_DDS::set_amplitude(int ch, uint16_t amplitude) {
+    _amplitude[ch] = amplitude > 32767 ? 32767 : amplitude;
+}
+
+void DAC81416_DDS::set_offset(int ch, uint16_t offset) {
+    _offset[ch] = offset;
+}
+
+//**************** Waveform sample at the current phase ***************//
+int16_t DAC81416_DDS::sample(uint8_t ch) {
+    uint32_t phase = _phase[ch];
+
+    if(_wave[ch] == TRIANGLE) {
+        // Shift a quarter period so it starts at 0 rising, like the sine
+        uint16_t p = (phase >> 16) + 0x4000;
+        int32_t v = p < 0x8000 ? (int32_t)p - 0x4000 : 0xC000 - (int32_t)p;
+        v *= 2;
+        return v > 32767 ? 32767 : v;
+    }
+
+    const int16_t *table = _wave[ch] == TABLE ? _table : DDS_SINE;
+    uint8_t idx = phase >> 24;
+    int16_t a = (int16_t)pgm_read_word(&table[idx]);
+
+    if(!_interpolate) return a;
+
+    int16_t b = (int16_t)pgm_read_word(&table[(uint8_t)(idx + 1)]);
+    uint8_t frac = (phase >> 16) & 0xFF;
+
+    return a + (((int32_t)(b - a) * frac) >> 8);
+}
+
+//**************** One tick ***************//
+void DAC81416_DDS::tick() {
+    uint8_t channels[16];
+    uint16_t values[16];
+    uint8_t n = 0;
+
+    uint16_t mask = _running;
+
+    for(uint8_t ch=0; mask; ch++, mask >>= 1) {
+        if(!(mask & 1)) continue;
+
+        int32_t v = (int32_t)_offset[ch] + (((int32_t)sample(ch) * _amplitude[ch]) >> 15);
+        if(v < 0) v = 0;
+        if(v > 0xFFFF) v = 0xFFFF;
+
+        channels[n] = ch;
+        values[n] = v;
+        n++;
+
+        _phase[ch] += _step[ch];
+    }
+
+    if(!n) return;
+
+    _dac->set_out_batch(channels, values, n);
+    _dac->sync();
+}
@@ -0,0 +1,94 @@
+#ifndef DAC81416_DDS_H
+#define DAC81416_DDS_H
+
+// Includes
+
+#include <stdint.h>
+#include "dac81416.h"
+
+// Entries in a waveform table, one full period
+#define DDS_TABLE_SIZE 256
+
+/*
+
+Direct digital synthesis
+
+Each channel has a 32-bit phase accumulator advanced by a tuning word every
+tick, the top 8 bits index a 256 entry waveform table (shared, in PROGMEM),
+the next 8 bits interpolate between entries if enabled. Samples are signed,
+scaled by a per-channel amplitude and added to a per-channel offset, all in
+integer maths so no sample buffers are needed.
+
+tick() writes every running channel in one batch and pulses LDAC, so all
+outputs change together. Call it at the tick rate given to the constructor
+from a timer ISR or loop(); it is the bus owner for that DAC while running.
+
+    frequency = tuning word * tick_hz / 2^32
+
+*/
+
+class DAC81416_DDS {
+
+    public:
+        enum Waveform {
+            SINE,        // Built-in table
+            TRIANGLE,    // Computed from the phase, no table
+            TABLE};      // Table given to set_table()
+
+    private:
+        DAC81416 *_dac;
+        float _tick_hz;
+        bool _interpolate;
+
+        // Arbitrary waveform, DDS_TABLE_SIZE signed samples in PROGMEM
+        const int16_t *_table;
+
+        // Per channel state
+        uint32_t _phase[16];
+        uint32_t _step[16];
+        uint16_t _amplitude[16];   // Peak deviation in DAC codes, 0 to 32767
+        uint16_t _offset[16];      // Centre code
+        uint16_t _phase_offset[16];
+        uint8_t  _wave[16];
+
+        // Channels written by tick()
+        uint16_t _running;
+
+        int16_t sample(uint8_t ch);
+
+    public:
+
+        DAC81416_DDS(DAC81416 *dac, float tick_hz);
+
+        // Use table (DDS_TABLE_SIZE signed samples, PROGMEM) for TABLE channels
+        void set_table(const int16_t *table);
+
+        // Linear interpolation between table entries, on by default
+        void set_interpolation(bool state);
+
+        // Configure and start a channel, the channel is switched to SYNC mode
+        void start(int ch, Waveform wave, float freq_hz, uint16_t amplitude, uint16_t offset);
+
+        // Stop updating a channel, its output holds the last value
+        void stop(int ch);
+
+        // Change frequency without a phase jump
+        void set_frequency(int ch, float freq_hz);
+
+        // Phase in 1/65536 of a period, 0x4000 = 90 degrees
+        void set_phase(int ch, uint16_t phase);
+
+        // Zero every accumulator, then apply set_phase() offsets again to line channels up
+        void reset_phase();
+
+        void set_amplitude(int ch, uint16_t amplitude);
+        void set_offset(int ch, uint16_t offset);
+
+        // Advance every running channel by one tick and write them in one LDAC synchronised batch
+        void tick();
+
+        // Running channels, bit n = channel n
+        uint16_t running() { return _running; }
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include "dac81416_queue.h"
+
+// Lock free only where the core has native 16-bit atomics. On AVR and
+// ARMv6-M (SAMD21, RP2040) __atomic_*_2 would be libcalls many cores lack
+#if defined(__GCC_ATOMIC_SHORT_LOCK_FREE) && __GCC_ATOMIC_SHORT_LOCK_FREE == 2
+#define QUEUE_LOCK_FREE 1
+#else
+#define QUEUE_LOCK_FREE 0
+#endif
+
+#if !QUEUE_LOCK_FREE
+// Interrupts off while in scope, previous state restored on exit
+class QueueCritical {
+
+    private:
+#if defined(__AVR__)
+        uint8_t _sreg;
+
+    public:
+        QueueCritical() { _sreg = SREG; cli(); }
+        ~QueueCritical() { SREG = _sreg; }
+#elif defined(__arm__)
+        uint32_t _primask;
+
+    public:
+        QueueCritical() { __asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r"(_primask) :: "memory"); }
+        ~QueueCritical() { __asm__ volatile("msr primask, %0" :: "r"(_primask) : "memory"); }
+#else
+    public:
+        QueueCritical() { noInterrupts(); }
+        ~QueueCritical() { interrupts(); }
+#endif
+};
+#endif
+
+// Queue constructor
+DAC81416_UpdateQueue::DAC81416_UpdateQueue() {
+    _count = 0;
+
+    for(int d=0; d<DAC81416_QUEUE_MAX_DEVICES; d++) {
+        _dacs[d] = 0;
+        _dirty[d] = 0;
+
+        for(int ch=0; ch<=15; ch++) _value[d][ch] = 0;
+    }
+}
+
+int DAC81416_UpdateQueue::attach(DAC81416 *dac) {
+
+    if(_count >= DAC81416_QUEUE_MAX_DEVICES) return -1;
+
+    _dacs[_count] = dac;
+    return _count++;
+}
+
+//****************** Producer side ******************//
+/*
+
+The value is stored before the dirty bit is set, and the consumer clears the
+dirty bit before it loads the value. If a producer lands between the two the
+consumer simply picks up the newer value and the bit is set again, which costs
+at most one redundant write of the same value. No update is ever lost.
+
+*/
+bool DAC81416_UpdateQueue::push(uint8_t dev, uint8_t ch, uint16_t val) {
+
+    if(dev >= _count || ch > 15) return false;
+
+#if !QUEUE_LOCK_FREE
+    // 16-bit stores are two instructions on AVR, an ISR could tear them
+    {
+        QueueCritical lock;
+        _value[dev][ch] = val;
+        _dirty[dev] |= (1 << ch);
+    }
+#else
+    __atomic_store_n(&_value[dev][ch], val, __ATOMIC_RELAXED);
+    __atomic_fetch_or(&_dirty[dev], (uint16_t)(1 << ch), __ATOMIC_RELEASE);
+#endif
+
+    return true;
+}
+
+//****************** Consumer side ******************//
+uint16_t DAC81416_UpdateQueue::take_dirty(uint8_t dev) {
+    uint16_t mask;
+
+#if !QUEUE_LOCK_FREE
+    {
+        QueueCritical lock;
+        mask = _dirty[dev];
+        _dirty[dev] = 0;
+    }
+#else
+    mask = __atomic_exchange_n(&_dirty[dev], (uint16_t)0, __ATOMIC_ACQUIRE);
+#endif
+
+    return mask;
+}
+
+uint16_t DAC81416_UpdateQueue::load_value(uint8_t dev, uint8_t ch) {
+    uint16_t val;
+
+#if !QUEUE_LOCK_FREE
+    {
+        QueueCritical lock;
+        val = _value[dev][ch];
+    }
+#else
+    val = __atomic_load_n(&_value[dev][ch], __ATOMIC_RELAXED);
+#endif
+
+    return val;
+}
+
+int DAC81416_UpdateQueue::drain() {
+    int written = 0;
+
+    uint8_t channels[16];
+    uint16_t values[16];
+
+    for(uint8_t d=0; d<_count; d++) {
+
+        uint16_t mask = take_dirty(d);
+        uint8_t n = 0;
+
+        for(uint8_t ch=0; mask; ch++, mask >>= 1) {
+            if(mask & 1) {
+                channels[n] = ch;
+                values[n] = load_value(d, ch);
+                n++;
+            }
+        }
+
+        // One batch per device
+        if(n) _dacs[d]->set_out_batch(channels, values, n);
+        written += n;
+    }
+
+    return written;
+}
+
+bool DAC81416_UpdateQueue::pending() {
+
+    for(uint8_t d=0; d<_count; d++) {
+#if !QUEUE_LOCK_FREE
+        uint16_t mask;
+        {
+            QueueCritical lock;
+            mask = _dirty[d];
+        }
+        if(mask) return true;
+#else
+        if(__atomic_load_n(&_dirty[d], __ATOMIC_RELAXED)) return true;
+#endif
+    }
+
+    return false;
+}
@@ -0,0 +1,70 @@
+#ifndef DAC81416_QUEUE_H
+#define DAC81416_QUEUE_H
+
+// Includes
+
+#include <stdint.h>
+#include "dac81416.h"
+
+// Maximum number of DACs that can share one queue
+#ifndef DAC81416_QUEUE_MAX_DEVICES
+#define DAC81416_QUEUE_MAX_DEVICES 4
+#endif
+
+/*
+
+ISR safe update queue
+
+write_reg() is not reentrant, so calling set_out() from a timer ISR while the
+main loop is half way through a transaction corrupts the SPI frame.
+
+Producers (any ISR or the main loop) only post (device, channel, value) into
+the queue with push(). One bus owner calls drain() and is the only code that
+touches SPI. Each channel has a single pending slot, so a burst of updates to
+the same channel becomes one write with the latest value (latest value wins).
+
+Lock free (GCC __atomic builtins) where the core has native 16-bit atomics,
+e.g. host builds and Cortex-M3 and up. Short critical sections elsewhere:
+AVR, where 16-bit stores are not atomic, and ARMv6-M (SAMD21, RP2040).
+
+*/
+
+class DAC81416_UpdateQueue {
+
+    private:
+        DAC81416 *_dacs[DAC81416_QUEUE_MAX_DEVICES];
+        uint8_t _count;
+
+        // Latest posted value per channel
+        volatile uint16_t _value[DAC81416_QUEUE_MAX_DEVICES][16];
+
+        // Bit n set means channel n has a value waiting to be written
+        volatile uint16_t _dirty[DAC81416_QUEUE_MAX_DEVICES];
+
+        // Atomically fetch and clear the pending mask of a device
+        uint16_t take_dirty(uint8_t dev);
+
+        // Atomic read of a pending value
+        uint16_t load_value(uint8_t dev, uint8_t ch);
+
+    public:
+
+        DAC81416_UpdateQueue();
+
+        // Register a DAC, returns its device index or -1 if the queue is full
+        // Call from setup() before any producer runs
+        int attach(DAC81416 *dac);
+
+        // Post an update. Safe from any ISR and from the main loop
+        bool push(uint8_t dev, uint8_t ch, uint16_t val);
+
+        // Write every pending update. Only the bus owner may call this
+        // Returns the number of channels written
+        int drain();
+
+        // Check if anything is waiting to be written
+        bool pending();
+
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "dac81416_scheduler.h"
+
+// Scheduler constructor
+DAC81416_Scheduler::DAC81416_Scheduler(DAC81416_Event *storage, uint16_t capacity) {
+    _heap = storage;
+    _capacity = capacity;
+    _size = 0;
+    _seq = 0;
+    _count = 0;
+
+    for(int d=0; d<DAC81416_SCHED_MAX_DEVICES; d++) _dacs[d] = 0;
+
+    reset_stats();
+}
+
+int DAC81416_Scheduler::attach(DAC81416 *dac) {
+
+    if(_count >= DAC81416_SCHED_MAX_DEVICES) return -1;
+
+    _dacs[_count] = dac;
+    return _count++;
+}
+
+void DAC81416_Scheduler::reset_stats() {
+    _fired = 0;
+    _ticks = 0;
+    _late_max_us = 0;
+    _late_sum_us = 0;
+}
+
+void DAC81416_Scheduler::clear() {
+    _size = 0;
+    _seq = 0;
+}
+
+//****************** Heap ******************//
+bool DAC81416_Scheduler::schedule(uint32_t time_us, uint8_t dev, uint8_t ch, uint16_t val) {
+
+    if(_size >= _capacity || dev >= _count || ch > 15) return false;
+
+    DAC81416_Event e;
+    e.time_us = time_us;
+    e.device = dev;
+    e.channel = ch;
+    e.value = val;
+    e.seq = _seq++;
+
+    // Sift up from the new leaf
+    uint16_t i = _size++;
+
+    while(i > 0) {
+        uint16_t parent = (i - 1) / 2;
+        if(!before(e, _heap[parent])) break;
+
+        _heap[i] = _heap[parent];
+        i = parent;
+    }
+
+    _heap[i] = e;
+
+    return true;
+}
+
+// Remove _heap[0]
+void DAC81416_Scheduler::pop() {
+
+    DAC81416_Event last = _heap[--_size];
+    uint16_t i = 0;
+
+    // Sift the last leaf down from the root
+    while(true) {
+        uint16_t child = 2*i + 1;
+        if(child >= _size) break;
+
+        if(child + 1 < _size && before(_heap[child + 1], _heap[child])) child++;
+        if(!before(_heap[child], last)) break;
+
+        _heap[i] = _heap[child];
+        i = child;
+    }
+
+    if(_size) _heap[i] = last;
+}
+
+//****************** Firing ******************//
+uint16_t DAC81416_Scheduler::poll(uint32_t now_us) {
+
+    if(!_size || before(now_us, _heap[0].time_us)) return 0;
+
+    // Due values per device, bit n of pending = channel n
+    uint16_t values[DAC81416_SCHED_MAX_DEVICES][16];
+    uint16_t pending[DAC81416_SCHED_MAX_DEVICES] = {0};
+    uint16_t fired = 0;
+
+    // Popped in (time, seq) order, so a later event on the same channel overwrites an earlier one
+    while(_size && !before(now_us, _heap[0].time_us)) {
+        DAC81416_Event &e = _heap[0];
+
+        values[e.device][e.channel] = e.value;
+        pending[e.device] |= (1 << e.channel);
+
+        uint32_t late = now_us - e.time_us;
+        if(late > _late_max_us) _late_max_us = late;
+        _late_sum_us += late;
+        _fired++;
+
+        pop();
+    }
+
+    // One batch and one LDAC per device
+    for(uint8_t d=0; d<_count; d++) {
+        if(!pending[d]) continue;
+
+        uint8_t channels[16];
+        uint16_t vals[16];
+        uint8_t n = 0;
+
+        for(uint8_t ch=0; ch<=15; ch++) {
+            if(!(pending[d] & (1 << ch))) continue;
+
+            channels[n] = ch;
+            vals[n] = values[d][ch];
+            n++;
+        }
+
+        _dacs[d]->set_out_batch(channels, vals, n);
+        fired += n;
+    }
+
+    // LDAC after all batches, DACs sharing an LDAC line update together
+    for(uint8_t d=0; d<_count; d++) {
+        if(pending[d]) _dacs[d]->sync();
+    }
+
+    _ticks++;
+
+    return fired;
+}
+
+uint16_t DAC81416_Scheduler::poll() {
+
+    if(!_count) return 0;
+
+    return poll(_dacs[0]->get_transport()->now_us());
+}
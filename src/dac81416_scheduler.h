@@ -0,0 +1,110 @@
+#ifndef DAC81416_SCHEDULER_H
+#define DAC81416_SCHEDULER_H
+
+// Includes
+
+#include <stdint.h>
+#include "dac81416.h"
+
+// Maximum number of DACs one scheduler can drive
+#ifndef DAC81416_SCHED_MAX_DEVICES
+#define DAC81416_SCHED_MAX_DEVICES 4
+#endif
+
+// One timed output change
+struct DAC81416_Event {
+    uint32_t time_us;
+    uint8_t device;
+    uint8_t channel;
+    uint16_t value;
+
+    // Insertion order, breaks ties between events with the same time_us
+    uint32_t seq;
+};
+
+/*
+
+Sparse event scheduler
+
+Output changes are queued with a time, kept in a fixed capacity min-heap
+(caller supplied storage, no heap allocation). poll() fires everything that
+is due: per DAC all due channels go out in one set_out_batch() and then LDAC
+is pulsed, so every change of that tick appears at the same moment. Channels
+used here should be in SYNC mode (set_sync()).
+
+Call poll() from a timer ISR or loop(). If it runs in an ISR, schedule() in
+the main loop must be called with interrupts disabled.
+
+Times are micros() style and wrap, pending events must be within ~35 minutes
+of each other. poll(now_us) takes the time explicitly, so it runs just as
+well against a simulated clock.
+
+*/
+
+class DAC81416_Scheduler {
+
+    private:
+        DAC81416 *_dacs[DAC81416_SCHED_MAX_DEVICES];
+        uint8_t _count;
+
+        // Min-heap on (time_us, seq), _heap[0] is the next due event
+        DAC81416_Event *_heap;
+        uint16_t _capacity;
+        uint16_t _size;
+        uint32_t _seq;
+
+        // Lateness statistics
+        uint32_t _fired;
+        uint32_t _ticks;
+        uint32_t _late_max_us;
+        uint64_t _late_sum_us;      // 64-bit, 32 would wrap after ~72 minutes of total lateness
+
+        // a before b, wrap safe
+        static bool before(uint32_t a, uint32_t b) {
+            return (int32_t)(a - b) < 0;
+        }
+
+        // Heap order, events with the same time pop in the order they were scheduled
+        static bool before(const DAC81416_Event &a, const DAC81416_Event &b) {
+            if(a.time_us != b.time_us) return before(a.time_us, b.time_us);
+            return before(a.seq, b.seq);
+        }
+
+        void pop();
+
+    public:
+
+        // storage holds capacity events, owned by the caller
+        DAC81416_Scheduler(DAC81416_Event *storage, uint16_t capacity);
+
+        // Register a DAC, returns its device index or -1 if full
+        int attach(DAC81416 *dac);
+
+        // Queue an output change, false if the queue is full
+        bool schedule(uint32_t time_us, uint8_t dev, uint8_t ch, uint16_t val);
+
+        // Fire every event due at now_us, returns how many were written
+        // If a channel has several due events the latest one wins, for equal
+        // times the one scheduled last
+        uint16_t poll(uint32_t now_us);
+
+        // Same, using the clock of the first attached DAC's transport
+        uint16_t poll();
+
+        // Queue state
+        bool empty() { return _size == 0; }
+        uint16_t size() { return _size; }
+        uint32_t next_due() { return _size ? _heap[0].time_us : 0; }
+
+        // Drop every pending event
+        void clear();
+
+        // Lateness = poll time - event time
+        uint32_t get_fired() { return _fired; }
+        uint32_t get_ticks() { return _ticks; }
+        uint32_t get_late_max_us() { return _late_max_us; }
+        uint32_t get_late_mean_us() { return _fired ? (uint32_t)(_late_sum_us / _fired) : 0; }
+        void reset_stats();
+};
+
+#endif
@@ -0,0 +1,170 @@
+#include "dac81416_spidev.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+static int sys_open(const char *path, int flags) { return ::open(path, flags); }
+static int sys_close(int fd) { return ::close(fd); }
+static int sys_ioctl(int fd, unsigned long request, void *arg) { return ::ioctl(fd, request, arg); }
+
+const DAC81416_SpidevOps DAC81416_SPIDEV_SYSCALLS = { sys_open, sys_close, sys_ioctl };
+
+// Transport constructor
+DAC81416_Spidev::DAC81416_Spidev(const char *spidev, uint32_t spi_clock_hz,
+                                 const char *gpiochip, int rst_line, int ldac_line,
+                                 const DAC81416_SpidevOps *ops) {
+    _ops = ops;
+    _spidev = spidev;
+    _gpiochip = gpiochip;
+    _spi_clock_hz = spi_clock_hz;
+    _rst_line = rst_line;
+    _ldac_line = ldac_line;
+
+    _fd = -1;
+    _rst_fd = -1;
+    _ldac_fd = -1;
+}
+
+DAC81416_Spidev::~DAC81416_Spidev() {
+    if(_ldac_fd > -1) _ops->close(_ldac_fd);
+    if(_rst_fd > -1) _ops->close(_rst_fd);
+    if(_fd > -1) _ops->close(_fd);
+}
+
+bool DAC81416_Spidev::ok() {
+    return _fd > -1;
+}
+
+// Request one output line from the GPIO character device, idle HIGH
+int DAC81416_Spidev::request_line(int chip_fd, int line) {
+    struct gpiohandle_request req;
+
+    memset(&req, 0, sizeof(req));
+    req.lineoffsets[0] = line;
+    req.lines = 1;
+    req.flags = GPIOHANDLE_REQUEST_OUTPUT;
+    req.default_values[0] = 1;
+    strncpy(req.consumer_label, "dac81416", sizeof(req.consumer_label) - 1);
+
+    if(_ops->ioctl(chip_fd, GPIO_GET_LINEHANDLE_IOCTL, &req) < 0) return -1;
+    return req.fd;
+}
+
+void DAC81416_Spidev::set_line(int fd, bool level) {
+    struct gpiohandle_data data;
+
+    memset(&data, 0, sizeof(data));
+    data.values[0] = level ? 1 : 0;
+    _ops->ioctl(fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data);
+}
+
+void DAC81416_Spidev::begin() {
+
+    if(_fd > -1) return;
+
+    _fd = _ops->open(_spidev, O_RDWR);
+    if(_fd < 0) return;
+
+    uint8_t mode = SPI_MODE_0;
+    uint8_t bits = 8;
+    uint32_t speed = _spi_clock_hz;
+
+    if(_ops->ioctl(_fd, SPI_IOC_WR_MODE, &mode) < 0 ||
+       _ops->ioctl(_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+       _ops->ioctl(_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+        _ops->close(_fd);
+        _fd = -1;
+        return;
+    }
+
+    // RESET and LDAC lines, the chip fd is not needed once the lines are held
+    if(_gpiochip && (_rst_line > -1 || _ldac_line > -1)) {
+        int chip_fd = _ops->open(_gpiochip, O_RDWR);
+
+        if(chip_fd > -1) {
+            if(_rst_line > -1) _rst_fd = request_line(chip_fd, _rst_line);
+            if(_ldac_line > -1) _ldac_fd = request_line(chip_fd, _ldac_line);
+            _ops->close(chip_fd);
+        }
+    }
+}
+
+/*
+
+Every frame is one spi_ioc_transfer. cs_change on all but the last transfer of
+a message releases CS between frames, the last one leaves it at the default
+(released at the end of the message).
+
+*/
+void DAC81416_Spidev::transfer(const uint8_t *tx, uint8_t *rx, uint8_t len, uint16_t count) {
+
+    // A dead bus reads as all zeros, never as stale stack contents
+    if(rx) memset(rx, 0, count * len);
+
+    if(_fd < 0) return;
+
+    while(count) {
+        uint16_t n = count < DAC81416_SPIDEV_MAX_XFERS ? count : DAC81416_SPIDEV_MAX_XFERS;
+
+        memset(_xfer, 0, n * sizeof(_xfer[0]));
+
+        for(uint16_t f=0; f<n; f++) {
+            _xfer[f].tx_buf = (uintptr_t)(tx + f*len);
+            _xfer[f].rx_buf = rx ? (uintptr_t)(rx + f*len) : 0;
+            _xfer[f].len = len;
+            _xfer[f].speed_hz = _spi_clock_hz;
+            _xfer[f].bits_per_word = 8;
+            _xfer[f].cs_change = (f != n - 1);
+        }
+
+        if(_ops->ioctl(_fd, SPI_IOC_MESSAGE(n), _xfer) < 0 && rx) memset(rx, 0, n*len);
+
+        tx += n*len;
+        if(rx) rx += n*len;
+        count -= n;
+    }
+}
+
+void DAC81416_Spidev::pulse_ldac() {
+
+    if(_ldac_fd < 0) return;
+
+    // Each ioctl takes microseconds, far longer than the 40ns minimum
+    set_line(_ldac_fd, false);
+    set_line(_ldac_fd, true);
+}
+
+bool DAC81416_Spidev::has_ldac() {
+    return _ldac_fd > -1;
+}
+
+void DAC81416_Spidev::set_reset(bool level) {
+    if(_rst_fd > -1) set_line(_rst_fd, level);
+}
+
+bool DAC81416_Spidev::has_reset() {
+    return _rst_fd > -1;
+}
+
+void DAC81416_Spidev::delay_ms(uint32_t ms) {
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, 0);
+}
+
+uint32_t DAC81416_Spidev::now_us() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+#endif
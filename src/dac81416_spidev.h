@@ -0,0 +1,90 @@
+#ifndef DAC81416_SPIDEV_H
+#define DAC81416_SPIDEV_H
+
+// Linux only, the Arduino build skips this file
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+// Includes
+
+#include <stdint.h>
+#include <linux/spi/spidev.h>
+#include "dac81416_transport.h"
+
+// Max frames per SPI_IOC_MESSAGE, bigger batches are split over several ioctls
+#ifndef DAC81416_SPIDEV_MAX_XFERS
+#define DAC81416_SPIDEV_MAX_XFERS 64
+#endif
+
+/*
+
+File descriptor layer
+
+All syscalls the spidev transport makes go through this table, so it can be
+pointed at a fake that records the submitted spi_ioc_transfer arrays instead
+of a real /dev/spidevX.Y.
+
+*/
+struct DAC81416_SpidevOps {
+    int (*open)(const char *path, int flags);
+    int (*close)(int fd);
+    int (*ioctl)(int fd, unsigned long request, void *arg);
+};
+
+// The real open/close/ioctl
+extern const DAC81416_SpidevOps DAC81416_SPIDEV_SYSCALLS;
+
+
+//****************** Linux spidev transport ******************//
+/*
+
+Frames are mapped onto /dev/spidevX.Y, a whole batch goes down in a single
+SPI_IOC_MESSAGE(n) with cs_change set between frames so CS still toggles per
+frame. RESET and LDAC are lines on a GPIO character device (/dev/gpiochipN).
+
+*/
+class DAC81416_Spidev : public DAC81416_Transport {
+
+    private:
+        const DAC81416_SpidevOps *_ops;
+
+        const char *_spidev;
+        const char *_gpiochip;
+        uint32_t _spi_clock_hz;
+
+        // GPIO line offsets on _gpiochip, -1 if not connected
+        int _rst_line;
+        int _ldac_line;
+
+        // File descriptors, -1 when closed
+        int _fd;
+        int _rst_fd;
+        int _ldac_fd;
+
+        struct spi_ioc_transfer _xfer[DAC81416_SPIDEV_MAX_XFERS];
+
+        int request_line(int chip_fd, int line);
+        void set_line(int fd, bool level);
+
+    public:
+        DAC81416_Spidev(const char *spidev, uint32_t spi_clock_hz = 8000000,
+                        const char *gpiochip = 0, int rst_line = -1, int ldac_line = -1,
+                        const DAC81416_SpidevOps *ops = &DAC81416_SPIDEV_SYSCALLS);
+        ~DAC81416_Spidev();
+
+        // False if the spidev could not be opened or configured
+        bool ok();
+
+        void begin();
+        void transfer(const uint8_t *tx, uint8_t *rx, uint8_t len, uint16_t count);
+        void pulse_ldac();
+        bool has_ldac();
+        void set_reset(bool level);
+        bool has_reset();
+        void delay_ms(uint32_t ms);
+        uint32_t now_us();
+};
+
+#endif
+
+#endif
@@ -0,0 +1,200 @@
+#include "dac81416_trace.h"
+
+#include <string.h>
+
+#if defined(__linux__) && !defined(ARDUINO)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+//****************** Trace log ******************//
+DAC81416_TraceLog::DAC81416_TraceLog() {
+    _header = 0;
+    _records = 0;
+}
+
+void DAC81416_TraceLog::reset_header(uint32_t capacity) {
+    _header->magic = DAC81416_TRACE_MAGIC;
+    _header->version = DAC81416_TRACE_VERSION;
+    _header->record_size = sizeof(DAC81416_TraceRecord);
+    _header->capacity = capacity;
+    _header->head = 0;
+}
+
+void DAC81416_TraceLog::append(const DAC81416_TraceRecord &rec) {
+
+    if(!_header || !_header->capacity) return;
+
+    _records[_header->head % _header->capacity] = rec;
+    _header->head++;
+}
+
+void DAC81416_TraceLog::clear() {
+    if(_header) _header->head = 0;
+}
+
+uint32_t DAC81416_TraceLog::size() {
+
+    if(!_header) return 0;
+
+    return _header->head < _header->capacity ? _header->head : _header->capacity;
+}
+
+const DAC81416_TraceRecord &DAC81416_TraceLog::at(uint32_t i) {
+
+    // Once wrapped the oldest record sits at the write position
+    uint32_t first = _header->head < _header->capacity ? 0 : _header->head % _header->capacity;
+
+    return _records[(first + i) % _header->capacity];
+}
+
+#if defined(ARDUINO)
+void DAC81416_TraceLog::dump(Print &out) {
+
+    if(!_header) return;
+
+    out.write((const uint8_t *)_header, sizeof(DAC81416_TraceHeader));
+    out.write((const uint8_t *)_records, _header->capacity * sizeof(DAC81416_TraceRecord));
+}
+#endif
+
+
+//****************** RAM ring (MCU) ******************//
+DAC81416_TraceRing::DAC81416_TraceRing(DAC81416_TraceRecord *records, uint32_t capacity) {
+    _header = &_ram_header;
+    _records = records;
+
+    reset_header(capacity);
+}
+
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+//****************** Memory-mapped file (host) ******************//
+DAC81416_TraceFile::DAC81416_TraceFile(const char *path, uint32_t capacity) {
+    _map = 0;
+    _map_len = sizeof(DAC81416_TraceHeader) + capacity * sizeof(DAC81416_TraceRecord);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return;
+
+    if(ftruncate(fd, _map_len) == 0) {
+        void *map = mmap(0, _map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(map != MAP_FAILED) _map = map;
+    }
+
+    // The mapping stays valid after the fd is closed
+    close(fd);
+
+    if(!_map) return;
+
+    _header = (DAC81416_TraceHeader *)_map;
+    _records = (DAC81416_TraceRecord *)((uint8_t *)_map + sizeof(DAC81416_TraceHeader));
+
+    reset_header(capacity);
+}
+
+DAC81416_TraceFile::~DAC81416_TraceFile() {
+
+    if(!_map) return;
+
+    flush();
+    munmap(_map, _map_len);
+}
+
+bool DAC81416_TraceFile::ok() {
+    return _map != 0;
+}
+
+void DAC81416_TraceFile::flush() {
+    if(_map) msync(_map, _map_len, MS_SYNC);
+}
+
+#endif
+
+
+//****************** Tracing transport ******************//
+DAC81416_TraceTransport::DAC81416_TraceTransport(DAC81416_Transport *bus, DAC81416_TraceLog *log, uint8_t device) {
+    _bus = bus;
+    _log = log;
+    _device = device;
+    _enabled = true;
+}
+
+void DAC81416_TraceTransport::begin() {
+    _bus->begin();
+}
+
+void DAC81416_TraceTransport::transfer(const uint8_t *tx, uint8_t *rx, uint8_t len, uint16_t count) {
+
+    if(!_enabled) {
+        _bus->transfer(tx, rx, len, count);
+        return;
+    }
+
+    uint32_t start = _bus->now_us();
+    _bus->transfer(tx, rx, len, count);
+    uint32_t took = _bus->now_us() - start;
+
+    DAC81416_TraceRecord rec;
+    uint8_t n = len < 4 ? len : 4;
+
+    for(uint16_t f=0; f<count; f++) {
+        memset(&rec, 0, sizeof(rec));
+        rec.timestamp_us = start;
+        rec.duration_us = took > 0xFFFF ? 0xFFFF : took;
+        rec.device = _device;
+        rec.flags = (TRACE_FRAME << 5) | n | (rx ? TRACE_RX : 0) | (f == 0 ? TRACE_BATCH : 0);
+
+        memcpy(rec.tx, tx + f*len, n);
+        if(rx) memcpy(rec.rx, rx + f*len, n);
+
+        _log->append(rec);
+    }
+}
+
+void DAC81416_TraceTransport::log_edge(uint8_t kind) {
+    DAC81416_TraceRecord rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.timestamp_us = _bus->now_us();
+    rec.device = _device;
+    rec.flags = (kind << 5) | TRACE_BATCH;
+
+    _log->append(rec);
+}
+
+void DAC81416_TraceTransport::pulse_ldac() {
+    _bus->pulse_ldac();
+    if(_enabled && _bus->has_ldac()) log_edge(TRACE_LDAC);
+}
+
+bool DAC81416_TraceTransport::has_ldac() {
+    return _bus->has_ldac();
+}
+
+void DAC81416_TraceTransport::set_reset(bool level) {
+    _bus->set_reset(level);
+    if(_enabled && _bus->has_reset()) log_edge(level ? TRACE_RESET_HIGH : TRACE_RESET_LOW);
+}
+
+bool DAC81416_TraceTransport::has_reset() {
+    return _bus->has_reset();
+}
+
+void DAC81416_TraceTransport::delay_ms(uint32_t ms) {
+    _bus->delay_ms(ms);
+}
+
+uint32_t DAC81416_TraceTransport::now_us() {
+    return _bus->now_us();
+}
+
+void DAC81416_TraceTransport::begin_session() {
+    _bus->begin_session();
+}
+
+void DAC81416_TraceTransport::end_session() {
+    _bus->end_session();
+}
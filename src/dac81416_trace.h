@@ -0,0 +1,167 @@
+#ifndef DAC81416_TRACE_H
+#define DAC81416_TRACE_H
+
+// Includes
+
+#include <stdint.h>
+#include "dac81416_transport.h"
+
+/*
+
+Binary bus trace
+
+Every frame that goes over the transport is logged as one fixed 16 byte
+record. The log is a ring: a header followed by capacity records, the same
+layout in RAM on an MCU and in a memory-mapped file on the host, so a RAM
+ring dumped over Serial and a host trace file decode the same way.
+
+Each FRAME record is one CS low -> CS high cycle. Frames clocked out by one
+transport call share a timestamp, the first one has TRACE_BATCH set and
+duration_us is the time the whole call took.
+
+Decode / replay tools live in extras/trace_tools.
+
+*/
+
+#define DAC81416_TRACE_MAGIC   0x52543844UL   // "D8TR"
+#define DAC81416_TRACE_VERSION 1
+
+// Record flags
+#define TRACE_LEN(f)     ((f) & 0x07)   // Frame length in bytes, 3 or 4
+#define TRACE_RX         0x08           // rx[] holds the bytes clocked in on SDO
+#define TRACE_BATCH      0x10           // First frame of a transport call
+#define TRACE_KIND(f)    (((f) >> 5) & 0x03)
+
+// Record kinds
+#define TRACE_FRAME      0
+#define TRACE_LDAC       1              // LDAC low pulse
+#define TRACE_RESET_LOW  2
+#define TRACE_RESET_HIGH 3
+
+struct DAC81416_TraceRecord {
+    uint32_t timestamp_us;
+    uint16_t duration_us;   // Whole transport call, saturates at 65535
+    uint8_t  device;
+    uint8_t  flags;
+    uint8_t  tx[4];         // MOSI bytes
+    uint8_t  rx[4];         // MISO bytes, valid if TRACE_RX
+};
+
+struct DAC81416_TraceHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t capacity;      // Records in the ring
+    uint32_t head;          // Records ever appended, next slot is head % capacity
+};
+
+
+//****************** Trace log ******************//
+class DAC81416_TraceLog {
+
+    protected:
+        DAC81416_TraceHeader *_header;
+        DAC81416_TraceRecord *_records;
+
+        void reset_header(uint32_t capacity);
+
+    public:
+        DAC81416_TraceLog();
+
+        // Add a record, the oldest one is overwritten once the ring is full
+        void append(const DAC81416_TraceRecord &rec);
+
+        // Drop everything logged so far
+        void clear();
+
+        // Records currently held, oldest first: at(0) .. at(size()-1)
+        uint32_t size();
+        const DAC81416_TraceRecord &at(uint32_t i);
+
+        // Raw layout, header then capacity records
+        const DAC81416_TraceHeader *header() { return _header; }
+
+#if defined(ARDUINO)
+        // Write the whole log as binary, e.g. dump(Serial)
+        void dump(Print &out);
+#endif
+};
+
+
+//****************** RAM ring (MCU) ******************//
+class DAC81416_TraceRing : public DAC81416_TraceLog {
+
+    private:
+        DAC81416_TraceHeader _ram_header;
+
+    public:
+        // records is caller owned storage for capacity records
+        DAC81416_TraceRing(DAC81416_TraceRecord *records, uint32_t capacity);
+};
+
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+//****************** Memory-mapped file (host) ******************//
+class DAC81416_TraceFile : public DAC81416_TraceLog {
+
+    private:
+        void *_map;
+        uint32_t _map_len;
+
+    public:
+        // Creates / truncates path to hold capacity records
+        DAC81416_TraceFile(const char *path, uint32_t capacity);
+        ~DAC81416_TraceFile();
+
+        // False if the file could not be created or mapped
+        bool ok();
+
+        // Push the mapping to disk
+        void flush();
+};
+
+#endif
+
+
+//****************** Tracing transport ******************//
+/*
+
+Sits between a DAC81416 and its real transport and logs everything:
+
+    DAC81416_ArduinoSPI bus(DAC_CS, DAC_RST, DAC_LDAC, &SPI, 30000000);
+    DAC81416_TraceRecord records[64];
+    DAC81416_TraceRing ring(records, 64);
+    DAC81416_TraceTransport traced(&bus, &ring, 0);
+    DAC81416 dac(&traced);
+
+*/
+class DAC81416_TraceTransport : public DAC81416_Transport {
+
+    private:
+        DAC81416_Transport *_bus;
+        DAC81416_TraceLog *_log;
+        uint8_t _device;
+        bool _enabled;
+
+        void log_edge(uint8_t kind);
+
+    public:
+        DAC81416_TraceTransport(DAC81416_Transport *bus, DAC81416_TraceLog *log, uint8_t device = 0);
+
+        // Tracing can be paused without rewiring the DAC
+        void set_enabled(bool state) { _enabled = state; }
+
+        void begin();
+        void transfer(const uint8_t *tx, uint8_t *rx, uint8_t len, uint16_t count);
+        void pulse_ldac();
+        bool has_ldac();
+        void set_reset(bool level);
+        bool has_reset();
+        void delay_ms(uint32_t ms);
+        uint32_t now_us();
+        void begin_session();
+        void end_session();
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "dac81416_transport.h"
+
+#if defined(ARDUINO)
+
+// Transport constructor
+DAC81416_ArduinoSPI::DAC81416_ArduinoSPI(int cspin, int rstpin, int ldacpin, SPIClass *spi, uint32_t spi_clock_hz) {
+    _cs_pin = cspin;
+    _rst_pin = rstpin;
+    _ldac_pin = ldacpin;
+    _spi = spi;
+
+    _spi_clock_hz = spi_clock_hz;
+    _spi_settings = SPISettings(spi_clock_hz, MSBFIRST, SPI_MODE0);
+}
+
+void DAC81416_ArduinoSPI::begin() {
+
+    if(_cs_pin > -1) {
+        pinMode(_cs_pin, OUTPUT);
+        digitalWrite(_cs_pin, HIGH);
+    }
+
+    // RESET pin setup
+    if(_rst_pin > -1) {
+        pinMode(_rst_pin, OUTPUT);
+        digitalWrite(_rst_pin, HIGH);
+    }
+
+    // LDAC pin setup, idle HIGH
+    if(_ldac_pin > -1) {
+        pinMode(_ldac_pin, OUTPUT);
+        digitalWrite(_ldac_pin, HIGH);
+    }
+
+    _spi->begin();
+}
+
+// Chip Select
+inline void DAC81416_ArduinoSPI::cs_on() {
+    digitalWrite(_cs_pin, LOW);
+}
+
+inline void DAC81416_ArduinoSPI::cs_off() {
+    digitalWrite(_cs_pin, HIGH);
+}
+
+//****************** Bus sessions ******************//
+/*
+
+Sessions belong to the SPIClass, not to one transport, so every DAC on the
+same bus with the same clock reuses the open transaction. SPISettings can't
+be compared on every core, the clock is used as the key instead (mode and
+bit order are always MODE0 / MSBFIRST here).
+
+*/
+struct DAC81416_SpiSession {
+    SPIClass *spi;
+    uint8_t depth;
+    uint32_t clock_hz;
+    SPISettings settings;
+};
+
+static DAC81416_SpiSession sessions[DAC81416_MAX_SPI_BUSES];
+
+static DAC81416_SpiSession *find_session(SPIClass *spi) {
+
+    for(uint8_t i=0; i<DAC81416_MAX_SPI_BUSES; i++) {
+        if(sessions[i].depth && sessions[i].spi == spi) return &sessions[i];
+    }
+
+    return 0;
+}
+
+void DAC81416_ArduinoSPI::begin_session() {
+
+    DAC81416_SpiSession *s = find_session(_spi);
+
+    // Nested, or another DAC on this bus already holds it
+    if(s) {
+        s->depth++;
+        return;
+    }
+
+    for(uint8_t i=0; i<DAC81416_MAX_SPI_BUSES; i++) {
+        if(sessions[i].depth) continue;
+
+        sessions[i].spi = _spi;
+        sessions[i].depth = 1;
+        sessions[i].clock_hz = _spi_clock_hz;
+        sessions[i].settings = _spi_settings;
+
+        _spi->beginTransaction(_spi_settings);
+        return;
+    }
+
+    // No free slot, transfer() falls back to a transaction per call
+}
+
+void DAC81416_ArduinoSPI::end_session() {
+
+    DAC81416_SpiSession *s = find_session(_spi);
+    if(!s) return;
+
+    if(--s->depth == 0) _spi->endTransaction();
+}
+
+// One transaction for the whole batch, CS toggled per frame
+void DAC81416_ArduinoSPI::transfer(const uint8_t *tx, uint8_t *rx, uint8_t len, uint16_t count) {
+
+    DAC81416_SpiSession *s = find_session(_spi);
+    bool own = !s || s->clock_hz != _spi_clock_hz;
+
+    // Open session with other settings, step out of it for this call
+    if(s && own) _spi->endTransaction();
+
+    if(own) _spi->beginTransaction(_spi_settings);
+
+    for(uint16_t f=0; f<count; f++) {
+        cs_on();
+        NOP;
+        for(uint8_t i=0; i<len; i++) {
+            uint8_t in = _spi->transfer(*tx++);
+            if(rx) *rx++ = in;
+        }
+        tcsh_delay();
+        cs_off();
+    }
+
+    if(own) _spi->endTransaction();
+    if(s && own) _spi->beginTransaction(s->settings);
+}
+
+/*
+
+Table 6-1
+
+Active low synchronization signal. When the LDAC pin is low, the DAC outputs of those channels
+configured in synchronous mode are updated simultaneously. Connect to VIO if unused.
+
+Table 6-8
+
+LDAC low time   VIO 1.7V to 2.7V	40ns
+LDAC low time   VIO 2.7V to 5.5V	20ns
+
+*/
+void DAC81416_ArduinoSPI::pulse_ldac() {
+
+    if(_ldac_pin < 0) return;
+
+	digitalWrite(_ldac_pin, LOW);
+	NOP;NOP;
+	digitalWrite(_ldac_pin, HIGH);
+}
+
+bool DAC81416_ArduinoSPI::has_ldac() {
+    return _ldac_pin > -1;
+}
+
+void DAC81416_ArduinoSPI::set_reset(bool level) {
+    if(_rst_pin > -1) digitalWrite(_rst_pin, level ? HIGH : LOW);
+}
+
+bool DAC81416_ArduinoSPI::has_reset() {
+    return _rst_pin > -1;
+}
+
+void DAC81416_ArduinoSPI::delay_ms(uint32_t ms) {
+    delay(ms);
+}
+
+uint32_t DAC81416_ArduinoSPI::now_us() {
+    return micros();
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef DAC81416_TRANSPORT_H
+#define DAC81416_TRANSPORT_H
+
+// Includes
+
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include "Arduino.h"
+#include "SPI.h"
+#endif
+
+// One SPI frame: register byte + 16-bit data, MSB first
+#define DAC81416_FRAME_LEN 3
+
+// NOP MACRO	62.5ns on 16MHz
+#define NOP __asm__("nop\n\t")
+
+/*
+
+Transport
+
+Everything the DAC81416 class needs from the outside world: clocking frames
+with CS toggled around each one, the LDAC and RESET lines, and time.
+
+Frames are handed over in batches so a backend can submit them in one go
+(one ioctl on Linux spidev) instead of one byte at a time.
+
+*/
+
+class DAC81416_Transport {
+
+    public:
+        virtual ~DAC81416_Transport() {}
+
+        // Set up the bus and the pins, safe to call more than once
+        virtual void begin() = 0;
+
+        // Clock out count frames of len bytes each, CS is toggled around every frame
+        // rx is either NULL or has room for count*len received bytes, and is
+        // zero filled if the bus is down or the transfer fails
+        virtual void transfer(const uint8_t *tx, uint8_t *rx, uint8_t len, uint16_t count) = 0;
+
+        // LDAC low pulse, does nothing if LDAC is not connected
+        virtual void pulse_ldac() = 0;
+        virtual bool has_ldac() = 0;
+
+        // Drive the RESET line, does nothing if RESET is not connected
+        virtual void set_reset(bool level) = 0;
+        virtual bool has_reset() = 0;
+
+        // Time
+        virtual void delay_ms(uint32_t ms) = 0;
+        virtual uint32_t now_us() = 0;
+
+        // Hold the bus across several transfer() calls, see DAC81416_BusSession
+        // Calls nest. Backends with nothing to amortise keep the defaults
+        virtual void begin_session() {}
+        virtual void end_session() {}
+};
+
+
+#if defined(ARDUINO)
+
+// SPIClass instances that can have a session open at the same time
+#ifndef DAC81416_MAX_SPI_BUSES
+#define DAC81416_MAX_SPI_BUSES 2
+#endif
+
+//****************** Arduino SPIClass transport ******************//
+class DAC81416_ArduinoSPI : public DAC81416_Transport {
+
+    private:
+        SPIClass *_spi;
+        SPISettings _spi_settings;
+        uint32_t _spi_clock_hz;
+
+        // pins
+        int _cs_pin;
+        int _rst_pin;
+        int _ldac_pin;
+
+        inline void cs_on();
+        inline void cs_off();
+
+        // Might not need NOP, just calling the SPI function is probably delay enough
+        inline void tcsh_delay() {
+            //delayMicroseconds(1);
+			      NOP;
+        }
+
+    public:
+        DAC81416_ArduinoSPI(int cspin = -1, int rstpin = -1, int ldacpin = -1,
+                            SPIClass *spi = &SPI, uint32_t spi_clock_hz=8000000);
+
+        void begin();
+        void transfer(const uint8_t *tx, uint8_t *rx, uint8_t len, uint16_t count);
+        void pulse_ldac();
+        bool has_ldac();
+        void set_reset(bool level);
+        bool has_reset();
+        void delay_ms(uint32_t ms);
+        uint32_t now_us();
+        void begin_session();
+        void end_session();
+};
+
+#endif
+
+#endif
@@ -0,0 +1,234 @@
+#include "dac81416_wavefile.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//****************** Writer ******************//
+DAC81416_WaveWriter::DAC81416_WaveWriter() {
+    _file = 0;
+}
+
+DAC81416_WaveWriter::~DAC81416_WaveWriter() {
+    close();
+}
+
+bool DAC81416_WaveWriter::open(const char *path, uint32_t sample_rate_hz, uint8_t channels,
+                               const uint8_t *channel_map, const DAC81416::ChannelRange *ranges) {
+
+    if(_file || channels < 1 || channels > 16) return false;
+
+    memset(&_header, 0, sizeof(_header));
+    _header.magic = DAC81416_WAVE_MAGIC;
+    _header.version = DAC81416_WAVE_VERSION;
+    _header.header_size = sizeof(DAC81416_WaveHeader);
+    _header.sample_rate_hz = sample_rate_hz;
+    _header.channels = channels;
+
+    for(uint8_t i=0; i<channels; i++) {
+        _header.channel_map[i] = channel_map[i];
+        _header.range[i] = ranges[i];
+    }
+
+    _file = fopen(path, "wb");
+    if(!_file) return false;
+
+    // Frame count is patched in by close()
+    return fwrite(&_header, sizeof(_header), 1, _file) == 1;
+}
+
+bool DAC81416_WaveWriter::write_frame(const uint16_t *codes) {
+
+    if(!_file) return false;
+
+    if(fwrite(codes, sizeof(uint16_t), _header.channels, _file) != _header.channels) return false;
+
+    _header.frames++;
+    return true;
+}
+
+bool DAC81416_WaveWriter::close() {
+
+    if(!_file) return false;
+
+    bool ok = fseek(_file, 0, SEEK_SET) == 0 &&
+              fwrite(&_header, sizeof(_header), 1, _file) == 1;
+
+    ok = (fclose(_file) == 0) && ok;
+    _file = 0;
+
+    return ok;
+}
+
+
+//****************** Memory-mapped player ******************//
+// Only the eight DACRANGE codes, anything else is reserved
+static bool valid_range(uint8_t range) {
+    switch(range) {
+        case DAC81416::U_5:  case DAC81416::U_10: case DAC81416::U_20: case DAC81416::U_40:
+        case DAC81416::B_5:  case DAC81416::B_10: case DAC81416::B_20: case DAC81416::B_2V5:
+            return true;
+    }
+
+    return false;
+}
+
+DAC81416_WavePlayer::DAC81416_WavePlayer(DAC81416 *dac) {
+    _dac = dac;
+    _map = 0;
+    _map_len = 0;
+    _header = 0;
+    _samples = 0;
+    _pos = 0;
+    _prefetched = 0;
+    _released = 0;
+}
+
+DAC81416_WavePlayer::~DAC81416_WavePlayer() {
+    close();
+}
+
+bool DAC81416_WavePlayer::open(const char *path) {
+
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(DAC81416_WaveHeader)) {
+        void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map != MAP_FAILED) {
+            _map = (const uint8_t *)map;
+            _map_len = st.st_size;
+        }
+    }
+
+    // The mapping stays valid after the fd is closed
+    ::close(fd);
+
+    if(!_map) return false;
+
+    const DAC81416_WaveHeader *h = (const DAC81416_WaveHeader *)_map;
+
+    // Header, and the samples it promises must be in the file
+    // Sizes are checked in 64-bit so a corrupt header cannot wrap them
+    if(h->magic != DAC81416_WAVE_MAGIC || h->version != DAC81416_WAVE_VERSION ||
+       h->header_size < sizeof(DAC81416_WaveHeader) || (h->header_size & 1) ||
+       (uint64_t)h->header_size > (uint64_t)_map_len ||
+       h->channels < 1 || h->channels > 16 || !h->sample_rate_hz ||
+       (uint64_t)h->frames > ((uint64_t)_map_len - h->header_size) / (2 * h->channels)) {
+        close();
+        return false;
+    }
+
+    for(uint8_t i=0; i<h->channels; i++) {
+        if(h->channel_map[i] > 15 || !valid_range(h->range[i])) {
+            close();
+            return false;
+        }
+    }
+
+    _header = h;
+    _samples = (const uint16_t *)(_map + h->header_size);
+
+    madvise((void *)_map, _map_len, MADV_SEQUENTIAL);
+    rewind();
+
+    return true;
+}
+
+void DAC81416_WavePlayer::close() {
+
+    if(_map) munmap((void *)_map, _map_len);
+
+    _map = 0;
+    _map_len = 0;
+    _header = 0;
+    _samples = 0;
+}
+
+void DAC81416_WavePlayer::rewind() {
+    _pos = 0;
+    _prefetched = 0;
+    _released = 0;
+
+    if(_map) advise(0);
+}
+
+// Keep one window read ahead of offset, drop what is more than one window behind
+void DAC81416_WavePlayer::advise(size_t offset) {
+
+    while(_prefetched < _map_len && offset + DAC81416_WAVE_PREFETCH >= _prefetched) {
+        size_t len = _map_len - _prefetched;
+        if(len > DAC81416_WAVE_PREFETCH) len = DAC81416_WAVE_PREFETCH;
+
+        madvise((void *)(_map + _prefetched), len, MADV_WILLNEED);
+        _prefetched += DAC81416_WAVE_PREFETCH;
+    }
+
+    while(offset >= _released + 2 * DAC81416_WAVE_PREFETCH) {
+        madvise((void *)(_map + _released), DAC81416_WAVE_PREFETCH, MADV_DONTNEED);
+        _released += DAC81416_WAVE_PREFETCH;
+    }
+}
+
+void DAC81416_WavePlayer::apply_ranges() {
+
+    if(!_header) return;
+
+    for(uint8_t i=0; i<_header->channels; i++) {
+        _dac->set_range(_header->channel_map[i], (DAC81416::ChannelRange)_header->range[i]);
+    }
+}
+
+bool DAC81416_WavePlayer::play_frame() {
+
+    if(!_header || _pos >= _header->frames) return false;
+
+    const uint16_t *frame = _samples + _pos * _header->channels;
+
+    // Straight from the mapping, codes are little endian like the host
+    _dac->set_out_batch(_header->channel_map, frame, _header->channels);
+    _dac->sync();
+
+    _pos++;
+    advise((const uint8_t *)frame - _map);
+
+    return true;
+}
+
+uint64_t DAC81416_WavePlayer::play(bool paced) {
+
+    if(!_header) return 0;
+
+    uint64_t played = 0;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    uint64_t start_ns = start.tv_sec * 1000000000ULL + start.tv_nsec;
+
+    while(true) {
+        if(paced) {
+            // Absolute deadlines, so sleep jitter does not add up
+            uint64_t due = start_ns + played * 1000000000ULL / _header->sample_rate_hz;
+            struct timespec ts;
+            ts.tv_sec = due / 1000000000ULL;
+            ts.tv_nsec = due % 1000000000ULL;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0);
+        }
+
+        if(!play_frame()) break;
+        played++;
+    }
+
+    return played;
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef DAC81416_WAVEFILE_H
+#define DAC81416_WAVEFILE_H
+
+// Linux only, the Arduino build skips this file
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+// Includes
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+#include "dac81416.h"
+
+/*
+
+Waveform file
+
+    64 byte DAC81416_WaveHeader
+    frames * channels interleaved 16-bit DAC codes, little endian
+
+Frame n holds one code per file channel, file channel i goes to DAC channel
+channel_map[i] with output range range[i] (DAC81416::ChannelRange).
+
+*/
+
+// Codes are read and written as host uint16_t, which is only the file format on little endian
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "dac81416_wavefile: waveform files are little endian, big endian hosts are not supported"
+#endif
+
+#define DAC81416_WAVE_MAGIC   0x46573844UL   // "D8WF"
+#define DAC81416_WAVE_VERSION 1
+
+struct DAC81416_WaveHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;       // Offset of the first sample
+    uint32_t sample_rate_hz;    // Frames per second
+    uint8_t  channels;          // Codes per frame, 1 to 16
+    uint8_t  reserved0[3];
+    uint64_t frames;
+    uint8_t  channel_map[16];
+    uint8_t  range[16];
+    uint8_t  reserved1[8];
+};
+
+
+//****************** Writer ******************//
+class DAC81416_WaveWriter {
+
+    private:
+        FILE *_file;
+        DAC81416_WaveHeader _header;
+
+    public:
+        DAC81416_WaveWriter();
+        ~DAC81416_WaveWriter();
+
+        // channel_map and ranges hold one entry per file channel
+        bool open(const char *path, uint32_t sample_rate_hz, uint8_t channels,
+                  const uint8_t *channel_map, const DAC81416::ChannelRange *ranges);
+
+        // Append one frame of channels codes
+        bool write_frame(const uint16_t *codes);
+
+        // Patch the frame count into the header and close
+        bool close();
+};
+
+
+//****************** Memory-mapped player ******************//
+/*
+
+The file is mmap'd read-only and each frame is handed to set_out_batch()
+straight from the mapping, with no intermediate sample buffer. set_out_batch()
+still builds the MSB first SPI frames from the codes, so every sample is
+copied and byte swapped once on its way to the bus. Each frame is followed by
+an LDAC pulse.
+
+The mapping is marked MADV_SEQUENTIAL, and MADV_WILLNEED is issued one
+prefetch window ahead of the play position so the kernel reads ahead of the
+player instead of faulting on every page. Pages already played are dropped
+with MADV_DONTNEED, so long recordings don't grow the resident set.
+
+*/
+
+#ifndef DAC81416_WAVE_PREFETCH
+#define DAC81416_WAVE_PREFETCH (1UL << 20)
+#endif
+
+class DAC81416_WavePlayer {
+
+    private:
+        DAC81416 *_dac;
+
+        const uint8_t *_map;
+        size_t _map_len;
+        const DAC81416_WaveHeader *_header;
+        const uint16_t *_samples;
+
+        uint64_t _pos;              // Next frame
+        size_t _prefetched;         // Byte offset prefetched up to
+        size_t _released;           // Byte offset released up to
+
+        void advise(size_t offset);
+
+    public:
+        DAC81416_WavePlayer(DAC81416 *dac);
+        ~DAC81416_WavePlayer();
+
+        // Map and check a file, false if it is not a valid waveform file
+        bool open(const char *path);
+        void close();
+
+        // Header of the open file, NULL if none
+        const DAC81416_WaveHeader *header() { return _header; }
+
+        // set_range() every mapped channel from the header
+        void apply_ranges();
+
+        // Write the next frame and pulse LDAC, false at the end of the file
+        bool play_frame();
+
+        // Play to the end. paced follows sample_rate_hz, otherwise as fast as the bus allows
+        // Returns the number of frames played
+        uint64_t play(bool paced = true);
+
+        // Back to the first frame
+        void rewind();
+
+        uint64_t position() { return _pos; }
+};
+
+#endif
+
+#endif